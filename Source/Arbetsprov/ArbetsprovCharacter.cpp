@@ -1,15 +1,17 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "ArbetsprovCharacter.h"
+#include "ArbetsprovGameMode.h"
 #include "ArbetsprovProjectile.h"
-#include "ArbetsprovHUD.h"
 #include "Animation/AnimInstance.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
 #include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
 #include "GameFramework/InputSettings.h"
 #include "Kismet/GameplayStatics.h"
+#include "Net/UnrealNetwork.h"
 #include "Weapons/Gun.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogFPChar, Warning, All);
@@ -40,32 +42,32 @@ AArbetsprovCharacter::AArbetsprovCharacter()
 	FP_Arms->CastShadow = false;
 	FP_Arms->SetRelativeRotation(FRotator(1.9f, -19.19f, 5.2f));
 	FP_Arms->SetRelativeLocation(FVector(-0.5f, -4.4f, -155.7f));
+
+	EyeTraceParams = FCollisionQueryParams(SCENE_QUERY_STAT(EyeTrace), false, this);
 }
 
 void AArbetsprovCharacter::BeginPlay()
 {
 	// Call the base class  
 	Super::BeginPlay();
+}
 
-	const APlayerController* PlayerController = Cast<APlayerController>(GetController());
-	if(PlayerController)
-	{
-		FP_HUD = Cast<AArbetsprovHUD>(PlayerController->GetHUD());
-	}
+void AArbetsprovCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AArbetsprovCharacter, FP_Gun);
+	DOREPLIFETIME(AArbetsprovCharacter, Inventory);
 }
 
-void AArbetsprovCharacter::Tick(float DeltaTime)
+FLinearColor AArbetsprovCharacter::GetCrosshairColor() const
 {
-	if(FP_HUD)
+	if(FP_Gun)
 	{
-		FLinearColor Color = DefaultCrosshairColor;
-		if(FP_Gun)
-		{
-			Color = FP_Gun->GetCrosshairColor();
-		}
-
-		FP_HUD->SetCrosshairColor(Color);
+		return FP_Gun->GetStateSnapshot().CrosshairColor;
 	}
+
+	return DefaultCrosshairColor;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -83,8 +85,12 @@ void AArbetsprovCharacter::SetupPlayerInputComponent(class UInputComponent* Play
 	// Bind weapon events
 	PlayerInputComponent->BindAction("WeaponPrimary", IE_Pressed, this, &AArbetsprovCharacter::OnWeaponPrimary);
 	PlayerInputComponent->BindAction("WeaponSecondary", IE_Pressed, this, &AArbetsprovCharacter::OnWeaponSecondary);
+	PlayerInputComponent->BindAction("WeaponContinuous", IE_Pressed, this, &AArbetsprovCharacter::OnWeaponContinuousPressed);
+	PlayerInputComponent->BindAction("WeaponContinuous", IE_Released, this, &AArbetsprovCharacter::OnWeaponContinuousReleased);
 	PlayerInputComponent->BindAction("PickUp", IE_Pressed, this, &AArbetsprovCharacter::PickUpGun);
 	PlayerInputComponent->BindAction("Drop", IE_Pressed, this, &AArbetsprovCharacter::DropGun);
+	PlayerInputComponent->BindAction("NextWeapon", IE_Pressed, this, &AArbetsprovCharacter::SwitchToNextGun);
+	PlayerInputComponent->BindAction("PreviousWeapon", IE_Pressed, this, &AArbetsprovCharacter::SwitchToPreviousGun);
 
 	// Bind movement events
 	PlayerInputComponent->BindAxis("MoveForward", this, &AArbetsprovCharacter::MoveForward);
@@ -103,8 +109,16 @@ void AArbetsprovCharacter::OnWeaponPrimary()
 {
 	if (!FP_Gun) return;
 	
+	NotifyWeaponInteraction();
 	const bool bSuccess = FP_Gun->PrimaryAction();
 
+	// The local action is a prediction, the server decides from the view the player had.
+	if (!HasAuthority())
+	{
+		const FGunActionView View = GetLocalActionView();
+		ServerWeaponPrimary(View.Timestamp, View.Location, View.Direction);
+	}
+
 	// TODO: Refactor animations, should probably be decided by the gun instance?
 	// try and play a firing animation if specified
 	if (bSuccess && FireAnimation != nullptr)
@@ -122,8 +136,15 @@ void AArbetsprovCharacter::OnWeaponSecondary()
 {
 	if (!FP_Gun) return;
 	
+	NotifyWeaponInteraction();
 	const bool bSuccess = FP_Gun->SecondaryAction();
 
+	if (!HasAuthority())
+	{
+		const FGunActionView View = GetLocalActionView();
+		ServerWeaponSecondary(View.Timestamp, View.Location, View.Direction);
+	}
+
 	// TODO: Refactor animations, should probably be decided by the gun instance?
 	// try and play a firing animation if specified
 	if (bSuccess && FireAnimation != nullptr)
@@ -137,6 +158,87 @@ void AArbetsprovCharacter::OnWeaponSecondary()
 	}
 }
 
+void AArbetsprovCharacter::OnWeaponContinuousPressed()
+{
+	if (!FP_Gun) return;
+
+	NotifyWeaponInteraction();
+	FP_Gun->StartContinuousAction();
+}
+
+void AArbetsprovCharacter::OnWeaponContinuousReleased()
+{
+	if (!FP_Gun) return;
+
+	FP_Gun->StopContinuousAction();
+}
+
+void AArbetsprovCharacter::NotifyWeaponInteraction() const
+{
+	AArbetsprovGameMode* GameMode = GetWorld()->GetAuthGameMode<AArbetsprovGameMode>();
+	if (GameMode)
+	{
+		GameMode->NotifyWeaponInteraction();
+	}
+}
+
+void AArbetsprovCharacter::ServerWeaponPrimary_Implementation(float Timestamp, FVector_NetQuantize10 ViewLocation, FVector_NetQuantizeNormal ViewDirection)
+{
+	if (!FP_Gun) return;
+
+	NotifyWeaponInteraction();
+	FP_Gun->PrimaryActionFromView(GetTrustedActionView(Timestamp, ViewLocation, ViewDirection));
+}
+
+bool AArbetsprovCharacter::ServerWeaponPrimary_Validate(float Timestamp, FVector_NetQuantize10 ViewLocation, FVector_NetQuantizeNormal ViewDirection)
+{
+	return FMath::IsFinite(Timestamp) && !ViewLocation.ContainsNaN() && !ViewDirection.ContainsNaN();
+}
+
+void AArbetsprovCharacter::ServerWeaponSecondary_Implementation(float Timestamp, FVector_NetQuantize10 ViewLocation, FVector_NetQuantizeNormal ViewDirection)
+{
+	if (!FP_Gun) return;
+
+	NotifyWeaponInteraction();
+	FP_Gun->SecondaryActionFromView(GetTrustedActionView(Timestamp, ViewLocation, ViewDirection));
+}
+
+bool AArbetsprovCharacter::ServerWeaponSecondary_Validate(float Timestamp, FVector_NetQuantize10 ViewLocation, FVector_NetQuantizeNormal ViewDirection)
+{
+	return FMath::IsFinite(Timestamp) && !ViewLocation.ContainsNaN() && !ViewDirection.ContainsNaN();
+}
+
+FGunActionView AArbetsprovCharacter::GetLocalActionView() const
+{
+	FGunActionView View;
+	View.Location = FP_Camera->GetComponentLocation();
+	View.Direction = GetControlRotation().Vector();
+
+	// The replicated server time lags the server by about half the round trip, like the replicated bodies the player sees.
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	View.Timestamp = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+
+	return View;
+}
+
+FGunActionView AArbetsprovCharacter::GetTrustedActionView(float Timestamp, const FVector& ViewLocation, const FVector& ViewDirection) const
+{
+	const FVector ServerLocation = FP_Camera->GetComponentLocation();
+
+	FGunActionView View;
+	View.Location = ServerLocation + (ViewLocation - ServerLocation).GetClampedToMaxSize(MaxClientViewError);
+	View.Direction = ViewDirection.GetSafeNormal();
+	// Rewinding further back than the recorded history clamps to its oldest frame.
+	View.Timestamp = FMath::Min(Timestamp, GetWorld()->GetTimeSeconds());
+
+	if (View.Direction.IsZero())
+	{
+		View.Direction = GetControlRotation().Vector();
+	}
+
+	return View;
+}
+
 void AArbetsprovCharacter::PickUpGun()
 {
 	FHitResult Hit;
@@ -152,28 +254,167 @@ void AArbetsprovCharacter::PickUpGun()
 
 void AArbetsprovCharacter::PickUpGun(AGun* Gun)
 {
-	if(Gun)
+	if(!HasAuthority())
+	{
+		ServerPickUpGun(Gun);
+		return;
+	}
+
+	if(Gun && !Inventory.Contains(Gun))
 	{
-		// If the player already has a gun, drop it. Assumes the player can only have one gun at a time.
+		// If the inventory is full, make room by dropping the current gun. The new gun is drawn instead of the next one.
+		if(Inventory.Num() >= MaxInventorySize && FP_Gun)
+		{
+			DropCurrentGun();
+		}
+
 		if(FP_Gun)
 		{
-			DropGun();
+			FP_Gun->Holster();
 		}
 
 		FP_Gun = Gun->PickUp(this);
-		FP_Gun->AttachToComponent(FP_Arms, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, true), TEXT("GripPoint"));
+		AttachGun(FP_Gun);
+		Inventory.Add(FP_Gun);
 	}
 }
 
 void AArbetsprovCharacter::DropGun()
 {
+	if(!HasAuthority())
+	{
+		ServerDropGun();
+		return;
+	}
+
 	if(FP_Gun)
 	{
-		FP_Gun->Drop();
-		FP_Gun = nullptr; // Assumes the player doesn't have any other guns than the one dropped.
+		const int32 Index = DropCurrentGun();
+
+		if(Inventory.Num() > 0)
+		{
+			SwitchToGun(Index == INDEX_NONE ? 0 : Index % Inventory.Num());
+		}
+	}
+}
+
+int32 AArbetsprovCharacter::DropCurrentGun()
+{
+	const int32 Index = Inventory.Find(FP_Gun);
+	if(Index != INDEX_NONE)
+	{
+		Inventory.RemoveAt(Index);
+	}
+
+	FP_Gun->Drop();
+	FP_Gun = nullptr;
+
+	return Index;
+}
+
+void AArbetsprovCharacter::SwitchToNextGun()
+{
+	if(Inventory.Num() > 1)
+	{
+		SwitchToGun((Inventory.Find(FP_Gun) + 1) % Inventory.Num());
 	}
 }
 
+void AArbetsprovCharacter::SwitchToPreviousGun()
+{
+	if(Inventory.Num() > 1)
+	{
+		SwitchToGun((Inventory.Find(FP_Gun) + Inventory.Num() - 1) % Inventory.Num());
+	}
+}
+
+void AArbetsprovCharacter::SwitchToGun(int32 Index)
+{
+	if(!HasAuthority())
+	{
+		ServerSwitchToGun(Index);
+		return;
+	}
+
+	if(!Inventory.IsValidIndex(Index) || Inventory[Index] == FP_Gun) return;
+
+	if(FP_Gun)
+	{
+		FP_Gun->Holster();
+	}
+
+	FP_Gun = Inventory[Index];
+	FP_Gun->Draw();
+}
+
+void AArbetsprovCharacter::ServerPickUpGun_Implementation(AGun* Gun)
+{
+	// The client traced from its own view, only take guns nobody carries that lie within reach here too.
+	if(!Gun || Gun->GetOwner()) return;
+	if(FVector::DistSquared(Gun->GetActorLocation(), FP_Camera->GetComponentLocation()) > FMath::Square(PickUpDistance + MaxClientViewError)) return;
+
+	PickUpGun(Gun);
+}
+
+void AArbetsprovCharacter::ServerDropGun_Implementation()
+{
+	DropGun();
+}
+
+void AArbetsprovCharacter::ServerSwitchToGun_Implementation(int32 Index)
+{
+	SwitchToGun(Index);
+}
+
+void AArbetsprovCharacter::OnRep_Guns()
+{
+	// Guns that are no longer carried were dropped.
+	for(AGun* Gun : LocalInventory)
+	{
+		if(Gun && !Inventory.Contains(Gun))
+		{
+			Gun->Drop();
+		}
+	}
+
+	// Guns that are new to the inventory were picked up, the server holsters all but the drawn one.
+	for(AGun* Gun : Inventory)
+	{
+		if(Gun && !LocalInventory.Contains(Gun))
+		{
+			Gun->PickUp(this);
+			AttachGun(Gun);
+
+			if(Gun != FP_Gun)
+			{
+				Gun->Holster();
+			}
+		}
+	}
+
+	if(FP_Gun != LocalGun)
+	{
+		if(LocalGun && Inventory.Contains(LocalGun))
+		{
+			LocalGun->Holster();
+		}
+
+		// Guns picked up above are already out.
+		if(FP_Gun && LocalInventory.Contains(FP_Gun))
+		{
+			FP_Gun->Draw();
+		}
+	}
+
+	LocalInventory = Inventory;
+	LocalGun = FP_Gun;
+}
+
+void AArbetsprovCharacter::AttachGun(AGun* Gun)
+{
+	Gun->AttachToComponent(FP_Arms, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, true), TEXT("GripPoint"));
+}
+
 void AArbetsprovCharacter::MoveForward(float Value)
 {
 	if (Value != 0.0f)
@@ -219,6 +460,6 @@ bool AArbetsprovCharacter::LineTraceSingleByChannelFromEyes(FHitResult& OutHit,
 		WorldLocation,
 		WorldLocation + WorldDirection * DistanceToCheck,
 		TraceChannel,
-		FCollisionQueryParams(FName(TEXT("")), false, GetOwner())
+		EyeTraceParams
 	);
 }
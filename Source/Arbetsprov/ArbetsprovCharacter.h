@@ -3,10 +3,13 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Engine/NetSerialization.h"
 #include "GameFramework/Character.h"
 #include "ArbetsprovCharacter.generated.h"
 
 class UInputComponent;
+struct FGunActionView;
 
 UCLASS(config=Game)
 class AArbetsprovCharacter : public ACharacter
@@ -16,8 +19,11 @@ class AArbetsprovCharacter : public ACharacter
 public:
 	AArbetsprovCharacter();
 
-	/** Tick function. */
-	virtual void Tick(float DeltaTime) override;
+	/**
+	 * Gets the color the crosshair should be, from the state the current gun published this frame.
+	 * @return The color of the crosshair.
+	 */
+	FLinearColor GetCrosshairColor() const;
 
 	/**
 	 * Linetrace from the center of the screen and forwards in the camera direction.
@@ -45,6 +51,8 @@ public:
 	/** Returns FP_Camera subobject **/
 	FORCEINLINE class UCameraComponent* GetFP_Camera() const { return FP_Camera; }
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 protected:
 	virtual void BeginPlay();
 
@@ -54,18 +62,106 @@ protected:
 	/** Triggers secondary action for the weapon. */
 	void OnWeaponSecondary();
 
+	/** Starts the continuous action of the weapon while the button is held. */
+	void OnWeaponContinuousPressed();
+
+	/** Stops the continuous action of the weapon. */
+	void OnWeaponContinuousReleased();
+
+	/** Lets the game mode measure the first weapon interaction. */
+	void NotifyWeaponInteraction() const;
+
+	/**
+	 * Performs the primary action of the gun on the server from the view the client had.
+	 * @param Timestamp - Server world time the client saw when pressing the button.
+	 * @param ViewLocation - The client's camera location.
+	 * @param ViewDirection - The client's view direction.
+	 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerWeaponPrimary(float Timestamp, FVector_NetQuantize10 ViewLocation, FVector_NetQuantizeNormal ViewDirection);
+
+	/**
+	 * Performs the secondary action of the gun on the server from the view the client had.
+	 * @param Timestamp - Server world time the client saw when pressing the button.
+	 * @param ViewLocation - The client's camera location.
+	 * @param ViewDirection - The client's view direction.
+	 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerWeaponSecondary(float Timestamp, FVector_NetQuantize10 ViewLocation, FVector_NetQuantizeNormal ViewDirection);
+
+	/**
+	 * Gets the view of this client as it is now, to send with a weapon action.
+	 * @return The camera location and direction, stamped with the server world time the client is seeing.
+	 */
+	FGunActionView GetLocalActionView() const;
+
+	/**
+	 * Makes a view received from the client safe to act on: not in the future and not further from the server's camera than MaxClientViewError.
+	 * @param Timestamp - Server world time the client saw.
+	 * @param ViewLocation - The client's camera location.
+	 * @param ViewDirection - The client's view direction.
+	 * @return The view to perform the action from.
+	 */
+	FGunActionView GetTrustedActionView(float Timestamp, const FVector& ViewLocation, const FVector& ViewDirection) const;
+
 	/** Linetrace and pick up gun if one is found. */
 	void PickUpGun();
 
 	/**
-	 * Picks up gun.
+	 * Picks up gun. Clients ask the server to do it.
 	 * @param Gun - The gun to pick up.
 	 */
 	void PickUpGun(class AGun* Gun);
 
-	/** Drops currently held gun. */
+	/** Drops currently held gun and draws the next one in the inventory. Clients ask the server to do it. */
 	void DropGun();
 
+	/**
+	 * Drops the currently held gun and removes it from the inventory without drawing another one.
+	 * @return The index the gun had in the inventory, INDEX_NONE if it wasn't in it.
+	 */
+	int32 DropCurrentGun();
+
+	/** Holsters the current gun and draws the next one in the inventory. */
+	void SwitchToNextGun();
+
+	/** Holsters the current gun and draws the previous one in the inventory. */
+	void SwitchToPreviousGun();
+
+	/**
+	 * Holsters the current gun and draws the gun at the index in the inventory. Clients ask the server to do it.
+	 * @param Index - The index of the gun in the inventory.
+	 */
+	void SwitchToGun(int32 Index);
+
+	/**
+	 * Picks up a gun the client found, if it's lying within reach of the server's character.
+	 * @param Gun - The gun to pick up.
+	 */
+	UFUNCTION(Server, Reliable)
+	void ServerPickUpGun(class AGun* Gun);
+
+	/** Drops the current gun on the server. */
+	UFUNCTION(Server, Reliable)
+	void ServerDropGun();
+
+	/**
+	 * Switches gun on the server.
+	 * @param Index - The index of the gun in the inventory.
+	 */
+	UFUNCTION(Server, Reliable)
+	void ServerSwitchToGun(int32 Index);
+
+	/** Picks up, drops, draws and holsters guns on this client to match the replicated inventory and drawn gun. */
+	UFUNCTION()
+	void OnRep_Guns();
+
+	/**
+	 * Attaches a carried gun to the hands.
+	 * @param Gun - The gun to attach.
+	 */
+	void AttachGun(class AGun* Gun);
+
 	/** Handles moving forward/backward */
 	void MoveForward(float Val);
 
@@ -98,14 +194,35 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Camera", meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FP_Camera = nullptr;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Weapon", meta = (AllowPrivateAccess = "True"))
+	/** The currently drawn gun, one of the guns in the inventory. Changed by the server. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, ReplicatedUsing = OnRep_Guns, Category = "Weapon", meta = (AllowPrivateAccess = "True"))
 	class AGun* FP_Gun = nullptr;
 
+	/** Every gun carried, the ones not drawn are holstered. Changed by the server. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, ReplicatedUsing = OnRep_Guns, Category = "Weapon", meta = (AllowPrivateAccess = "True"))
+	TArray<class AGun*> Inventory;
+
+	/** The inventory this client last matched its guns to. */
+	UPROPERTY(Transient)
+	TArray<class AGun*> LocalInventory;
+
+	/** The drawn gun this client last matched its guns to. */
+	UPROPERTY(Transient)
+	class AGun* LocalGun = nullptr;
+
+	/** Maximum amount of guns carried, picking up another one drops the current gun. */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = "1"))
+	int32 MaxInventorySize = 4;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
 	float PickUpDistance = 200.f;
 
-	UPROPERTY()
-	class AArbetsprovHUD* FP_HUD = nullptr;
+	/** How far the camera location a client acts from may be from the server's, the client's camera runs ahead by its latency. */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = "0"))
+	float MaxClientViewError = 200.f;
+
+	/** Collision query params for traces from the eyes, prebuilt so traces don't construct them every call. */
+	FCollisionQueryParams EyeTraceParams;
 
 	UPROPERTY(EditDefaultsOnly, Category = "HUD")
 	FLinearColor DefaultCrosshairColor = FLinearColor::White;
@@ -3,8 +3,14 @@
 #include "ArbetsprovGameMode.h"
 #include "ArbetsprovHUD.h"
 #include "ArbetsprovCharacter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Misc/App.h"
+#include "Props/GrabbablePropManager.h"
 #include "UObject/ConstructorHelpers.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogArbetsprovGameMode, Log, All);
+
 AArbetsprovGameMode::AArbetsprovGameMode()
 	: Super()
 {
@@ -14,4 +20,58 @@ AArbetsprovGameMode::AArbetsprovGameMode()
 
 	// use our custom HUD class
 	HUDClass = AArbetsprovHUD::StaticClass();
+
+	// tick is only enabled to measure the first weapon interaction
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void AArbetsprovGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	InitGameTime = FPlatformTime::Seconds();
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+}
+
+void AArbetsprovGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	// After BeginPlay so props absorbed from the level are warmed up too.
+	const double WarmUpStartTime = FPlatformTime::Seconds();
+	WarmUp();
+	WarmUpMilliseconds = (FPlatformTime::Seconds() - WarmUpStartTime) * 1000.0;
+
+	LoadMilliseconds = (FPlatformTime::Seconds() - InitGameTime) * 1000.0;
+	UE_LOG(LogArbetsprovGameMode, Log, TEXT("Started in %.1f ms, of which %.1f ms warm-up."), LoadMilliseconds, WarmUpMilliseconds);
+}
+
+void AArbetsprovGameMode::WarmUp()
+{
+	for (TActorIterator<AGrabbablePropManager> It(GetWorld()); It; ++It)
+	{
+		It->PrewarmComponents(WarmUpPropComponents);
+	}
+}
+
+void AArbetsprovGameMode::NotifyWeaponInteraction()
+{
+	if (InteractionFrame != 0) return;
+
+	InteractionFrame = GFrameCounter;
+	SetActorTickEnabled(true);
+}
+
+void AArbetsprovGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// The delta of the next frame is the duration of the frame the interaction happened in.
+	if (GFrameCounter > InteractionFrame)
+	{
+		UE_LOG(LogArbetsprovGameMode, Log, TEXT("First weapon interaction took a %.2f ms frame, starting took %.1f ms of which %.1f ms warm-up."),
+			FApp::GetDeltaTime() * 1000.0, LoadMilliseconds, WarmUpMilliseconds);
+
+		SetActorTickEnabled(false);
+	}
 }
@@ -13,7 +13,32 @@ class AArbetsprovGameMode : public AGameModeBase
 
 public:
 	AArbetsprovGameMode();
-};
 
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	/** Warms up the server side, props and their physics, after BeginPlay, before the first frame, so their first use doesn't hitch. Players warm up their own side in the HUD. */
+	virtual void StartPlay() override;
+
+	/** Only ticks on the frame after the first weapon interaction, to report its frame time. */
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Called by characters when a weapon is used, the first call is compared against the loading time. */
+	void NotifyWeaponInteraction();
 
+protected:
+	/** Creates what the first interactions with props would otherwise create lazily. */
+	void WarmUp();
 
+	/** Simulating components created up front by every grabbable prop manager. */
+	UPROPERTY(EditDefaultsOnly, Category = "Warm Up", meta = (ClampMin = "0"))
+	int32 WarmUpPropComponents = 16;
+
+private:
+	/** FPlatformTime::Seconds when InitGame was called. */
+	double InitGameTime = 0.0;
+	double LoadMilliseconds = 0.0;
+	double WarmUpMilliseconds = 0.0;
+
+	/** GFrameCounter of the first weapon interaction, 0 until there has been one. */
+	uint64 InteractionFrame = 0;
+};
@@ -1,39 +1,143 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "ArbetsprovHUD.h"
+#include "ArbetsprovCharacter.h"
 #include "Engine/Canvas.h"
 #include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
 #include "TextureResource.h"
 #include "CanvasItem.h"
 #include "UObject/ConstructorHelpers.h"
+#include "Weapons/Gun.h"
+#include "Weapons/WeaponAudioSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogArbetsprovHUD, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("HUD Rebuild Layout"), STAT_HUDRebuildLayout, STATGROUP_ArbetsprovHUD);
 
 AArbetsprovHUD::AArbetsprovHUD()
 {
 	// Set the crosshair texture
 	static ConstructorHelpers::FObjectFinder<UTexture2D> CrosshairTexObj(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair"));
 	CrosshairTex = CrosshairTexObj.Object;
+
+	// warm up the projectile fired by the character
+	static ConstructorHelpers::FClassFinder<AActor> ProjectileClassFinder(TEXT("/Game/FirstPersonCPP/Blueprints/FirstPersonProjectile"));
+	if (ProjectileClassFinder.Succeeded())
+	{
+		WarmUpActorClasses.Add(ProjectileClassFinder.Class);
+	}
+
+	// Guns publish their state after physics, read it at the end of the frame so the crosshair is never a frame behind
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+}
+
+void AArbetsprovHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (PlayerOwner && PlayerOwner->IsLocalController())
+	{
+		const double WarmUpStartTime = FPlatformTime::Seconds();
+		WarmUp();
+		UE_LOG(LogArbetsprovHUD, Log, TEXT("Warmed up the local player in %.1f ms."), (FPlatformTime::Seconds() - WarmUpStartTime) * 1000.0);
+	}
+}
+
+void AArbetsprovHUD::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	const AArbetsprovCharacter* Character = Cast<AArbetsprovCharacter>(GetOwningPawn());
+	if (Character)
+	{
+		SetCrosshairColor(Character->GetCrosshairColor());
+	}
 }
 
 void AArbetsprovHUD::DrawHUD()
 {
 	Super::DrawHUD();
 
+	const FVector2D CanvasSize(Canvas->ClipX, Canvas->ClipY);
+	if (bLayoutDirty || CanvasSize != LayoutCanvasSize)
+	{
+		LayoutCanvasSize = CanvasSize;
+		RebuildLayout();
+	}
+
+	Batcher.Draw(Canvas);
+}
+
+void AArbetsprovHUD::SetCrosshairColor(FLinearColor Color)
+{
+	if (Color != CrosshairColor)
+	{
+		CrosshairColor = Color;
+		MarkLayoutDirty();
+	}
+}
+
+void AArbetsprovHUD::WarmUp()
+{
+	static constexpr float RESIDENT_SECONDS = 30.f;
+	if (CrosshairTex)
+	{
+		CrosshairTex->SetForceMipLevelsToBeResident(RESIDENT_SECONDS);
+	}
+
+	MarkLayoutDirty();
+
+	UWorld* World = GetWorld();
+
+	if (UWeaponAudioSubsystem* Audio = World->GetSubsystem<UWeaponAudioSubsystem>())
+	{
+		Audio->PrewarmPool(WarmUpAudioComponents);
+	}
+
+	for (TActorIterator<AGun> It(World); It; ++It)
+	{
+		It->WarmUp();
+	}
+
+	// Spawning once creates the class's components, physics bodies and movement state, later spawns reuse what was loaded.
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	const FTransform OutOfSight(FVector(0.f, 0.f, -100000.f));
+	for (const TSubclassOf<AActor>& ActorClass : WarmUpActorClasses)
+	{
+		if (AActor* Actor = World->SpawnActor<AActor>(ActorClass, OutOfSight, SpawnParameters))
+		{
+			Actor->Destroy();
+		}
+	}
+}
+
+void AArbetsprovHUD::MarkLayoutDirty()
+{
+	bLayoutDirty = true;
+}
+
+void AArbetsprovHUD::RebuildLayout()
+{
+	SCOPE_CYCLE_COUNTER(STAT_HUDRebuildLayout);
+
+	bLayoutDirty = false;
+	Batcher.Reset();
+
 	// Draw very simple crosshair
 
 	// find center of the Canvas
-	const FVector2D Center(Canvas->ClipX * 0.5f, Canvas->ClipY * 0.5f);
+	const FVector2D Center(LayoutCanvasSize.X * 0.5f, LayoutCanvasSize.Y * 0.5f);
 
 	// offset by half the texture's dimensions so that the center of the texture aligns with the center of the Canvas
 	const FVector2D CrosshairDrawPosition( (Center.X),
 										   (Center.Y - CrosshairTex->GetImportedSize().Y / 2.f));
 
-	// draw the crosshair
-	FCanvasTileItem TileItem( CrosshairDrawPosition, CrosshairTex->Resource, CrosshairColor);
-	TileItem.BlendMode = SE_BLEND_Translucent;
-	Canvas->DrawItem( TileItem );
-}
-
-void AArbetsprovHUD::SetCrosshairColor(FLinearColor Color)
-{
-	CrosshairColor = Color;
+	// queue the crosshair
+	Batcher.AddTile(CrosshairTex, CrosshairDrawPosition, FVector2D(CrosshairTex->GetImportedSize()), CrosshairColor, SE_BLEND_Translucent);
 }
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/HUD.h"
+#include "HUDBatcher.h"
 #include "ArbetsprovHUD.generated.h"
 
 UCLASS()
@@ -14,17 +15,48 @@ class AArbetsprovHUD : public AHUD
 public:
 	AArbetsprovHUD();
 
+	/** Warms up what the local player sees and hears before the first frames, HUDs only exist for local players */
+	virtual void BeginPlay() override;
+
+	/** Pulls the crosshair color from the owning pawn, in TG_PostUpdateWork after guns have published their state */
+	virtual void Tick(float DeltaSeconds) override;
+
 	/** Primary draw call for the HUD */
 	virtual void DrawHUD() override;
 
 	/** Set the color of the crosshair */
 	void SetCrosshairColor(FLinearColor Color);
 
+	/** Forces the HUD items to be collected again on the next draw */
+	void MarkLayoutDirty();
+
+	/** Makes the crosshair texture resident, creates pooled audio components, primes gun sounds and spawns projectiles once, so their first use doesn't hitch */
+	void WarmUp();
+
 private:
+	/** Collects every HUD item into the batcher */
+	void RebuildLayout();
+
 	/** Crosshair asset pointer */
 	class UTexture2D* CrosshairTex;
 
 	/** Color for the crosshair */
 	FLinearColor CrosshairColor = FLinearColor::White;
 
+	/** Batched HUD items, only collected again when the layout is dirty */
+	FHUDBatcher Batcher;
+
+	/** Canvas size the layout was built for */
+	FVector2D LayoutCanvasSize = FVector2D::ZeroVector;
+
+	bool bLayoutDirty = true;
+
+	/** Classes spawned once and destroyed during warm-up, e.g. projectiles */
+	UPROPERTY(EditDefaultsOnly, Category = "Warm Up")
+	TArray<TSubclassOf<AActor>> WarmUpActorClasses;
+
+	/** Audio components created up front by the weapon audio subsystem */
+	UPROPERTY(EditDefaultsOnly, Category = "Warm Up", meta = (ClampMin = "0"))
+	int32 WarmUpAudioComponents = 8;
+
 };
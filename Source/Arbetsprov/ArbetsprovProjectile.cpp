@@ -3,6 +3,8 @@
 #include "ArbetsprovProjectile.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
+#include "Props/GrabbablePropManager.h"
+#include "Telemetry/TelemetrySubsystem.h"
 
 AArbetsprovProjectile::AArbetsprovProjectile() 
 {
@@ -31,8 +33,29 @@ AArbetsprovProjectile::AArbetsprovProjectile()
 	InitialLifeSpan = 3.0f;
 }
 
+void AArbetsprovProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UTelemetrySubsystem::Count(this, ETelemetryCounter::ProjectilesAlive);
+}
+
+void AArbetsprovProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UTelemetrySubsystem::Count(this, ETelemetryCounter::ProjectilesAlive, -1);
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AArbetsprovProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	// Idle props are instances, promote the one we hit so it can react to the impulse
+	FHitResult PropHit = Hit;
+	if (AGrabbablePropManager::PromoteHit(PropHit))
+	{
+		OtherComp = PropHit.GetComponent();
+	}
+
 	// Only add impulse and destroy projectile if we hit a physics
 	if ((OtherActor != NULL) && (OtherActor != this) && (OtherComp != NULL) && OtherComp->IsSimulatingPhysics())
 	{
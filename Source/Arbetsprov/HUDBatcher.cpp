@@ -0,0 +1,102 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#include "HUDBatcher.h"
+#include "BatchedElements.h"
+#include "CanvasTypes.h"
+#include "Engine/Canvas.h"
+#include "Engine/Font.h"
+#include "Engine/Texture.h"
+#include "TextureResource.h"
+
+DECLARE_CYCLE_STAT(TEXT("HUD Batch Draw"), STAT_HUDBatchDraw, STATGROUP_ArbetsprovHUD);
+DECLARE_DWORD_COUNTER_STAT(TEXT("HUD Batches"), STAT_HUDBatches, STATGROUP_ArbetsprovHUD);
+DECLARE_DWORD_COUNTER_STAT(TEXT("HUD Tiles"), STAT_HUDTiles, STATGROUP_ArbetsprovHUD);
+
+void FHUDBatcher::Reset()
+{
+	// Keep the memory, the same items are usually collected again.
+	for (FTileBatch& Batch : Batches)
+	{
+		Batch.Tiles.Reset();
+	}
+
+	Texts.Reset();
+}
+
+void FHUDBatcher::AddTile(const UTexture* Texture, const FVector2D& Position, const FVector2D& Size, const FLinearColor& Color, ESimpleElementBlendMode BlendMode)
+{
+	FTileBatch* Batch = Batches.FindByPredicate([Texture, BlendMode](const FTileBatch& Candidate)
+	{
+		return Candidate.Texture == Texture && Candidate.BlendMode == BlendMode;
+	});
+
+	if (!Batch)
+	{
+		Batch = &Batches.AddDefaulted_GetRef();
+		Batch->Texture = Texture;
+		Batch->BlendMode = BlendMode;
+	}
+
+	Batch->Tiles.Add({ Position, Size, Color });
+}
+
+void FHUDBatcher::AddText(const FText& Text, const UFont* Font, const FVector2D& Position, const FLinearColor& Color)
+{
+	FCanvasTextItem TextItem(Position, Text, Font, Color);
+
+	const int32 Index = Texts.IndexOfByPredicate([Font](const FCanvasTextItem& Other)
+	{
+		return Other.Font > Font;
+	});
+
+	Texts.Insert(TextItem, Index == INDEX_NONE ? Texts.Num() : Index);
+}
+
+void FHUDBatcher::Draw(UCanvas* Canvas)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HUDBatchDraw);
+
+	if (!Canvas || !Canvas->Canvas) return;
+
+	FCanvas* RenderCanvas = Canvas->Canvas;
+	const FHitProxyId HitProxyId = RenderCanvas->GetHitProxyId();
+
+	// Tiles are in canvas space, move them by the current canvas transform, e.g. DPI scale or a safe zone offset.
+	// The batches are requested under an identity transform so the transform isn't applied twice.
+	const FMatrix CanvasTransform = RenderCanvas->GetTransformStack().Top().GetMatrix();
+	RenderCanvas->PushAbsoluteTransform(FMatrix::Identity);
+
+	for (const FTileBatch& Batch : Batches)
+	{
+		// Without a texture resource, e.g. with -nullrhi, there is nothing to submit.
+		const FTexture* TextureResource = Batch.Texture ? Batch.Texture->Resource : nullptr;
+		if (!TextureResource || Batch.Tiles.Num() == 0) continue;
+
+		INC_DWORD_STAT(STAT_HUDBatches);
+		INC_DWORD_STAT_BY(STAT_HUDTiles, Batch.Tiles.Num());
+
+		FBatchedElements* Elements = RenderCanvas->GetBatchedElements(FCanvas::ET_Triangle, nullptr, TextureResource, Batch.BlendMode);
+		Elements->AddReserveVertices(Batch.Tiles.Num() * 4);
+		Elements->AddReserveTriangles(Batch.Tiles.Num() * 2, TextureResource, Batch.BlendMode);
+
+		for (const FTile& Tile : Batch.Tiles)
+		{
+			const FVector2D Max = Tile.Position + Tile.Size;
+
+			const int32 V0 = Elements->AddVertex(CanvasTransform.TransformFVector4(FVector4(Tile.Position.X, Tile.Position.Y, 0.f, 1.f)), FVector2D(0.f, 0.f), Tile.Color, HitProxyId);
+			const int32 V1 = Elements->AddVertex(CanvasTransform.TransformFVector4(FVector4(Max.X, Tile.Position.Y, 0.f, 1.f)), FVector2D(1.f, 0.f), Tile.Color, HitProxyId);
+			const int32 V2 = Elements->AddVertex(CanvasTransform.TransformFVector4(FVector4(Tile.Position.X, Max.Y, 0.f, 1.f)), FVector2D(0.f, 1.f), Tile.Color, HitProxyId);
+			const int32 V3 = Elements->AddVertex(CanvasTransform.TransformFVector4(FVector4(Max.X, Max.Y, 0.f, 1.f)), FVector2D(1.f, 1.f), Tile.Color, HitProxyId);
+
+			Elements->AddTriangle(V0, V1, V2, TextureResource, Batch.BlendMode);
+			Elements->AddTriangle(V2, V1, V3, TextureResource, Batch.BlendMode);
+		}
+	}
+
+	RenderCanvas->PopTransform();
+
+	for (FCanvasTextItem& TextItem : Texts)
+	{
+		Canvas->DrawItem(TextItem);
+	}
+}
@@ -0,0 +1,73 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CanvasItem.h"
+#include "Stats/Stats.h"
+
+class UCanvas;
+class UFont;
+class UTexture;
+
+DECLARE_STATS_GROUP(TEXT("ArbetsprovHUD"), STATGROUP_ArbetsprovHUD, STATCAT_Advanced);
+
+/**
+ * Collects HUD tiles and texts once and submits them every frame, one batch of triangles per texture.
+ * Items are only collected again after Reset, so a HUD that doesn't change costs one submission per texture.
+ */
+class FHUDBatcher
+{
+public:
+	/** Removes every item, call before collecting the items again. */
+	void Reset();
+
+	/**
+	 * Adds a textured tile.
+	 * @param Texture - The texture of the tile.
+	 * @param Position - Top left corner of the tile in canvas space.
+	 * @param Size - Size of the tile in canvas space.
+	 * @param Color - Color the texture is multiplied with.
+	 * @param BlendMode - How the tile is blended.
+	 */
+	void AddTile(const UTexture* Texture, const FVector2D& Position, const FVector2D& Size, const FLinearColor& Color, ESimpleElementBlendMode BlendMode = SE_BLEND_Translucent);
+
+	/**
+	 * Adds a text, texts are drawn after every tile.
+	 * @param Text - The text to draw.
+	 * @param Font - The font of the text.
+	 * @param Position - Top left corner of the text in canvas space.
+	 * @param Color - Color of the text.
+	 */
+	void AddText(const FText& Text, const UFont* Font, const FVector2D& Position, const FLinearColor& Color);
+
+	/**
+	 * Submits every item to the canvas.
+	 * @param Canvas - The canvas to draw on.
+	 */
+	void Draw(UCanvas* Canvas);
+
+	/** Returns whether or not there are any items. */
+	FORCEINLINE bool IsEmpty() const { return Batches.Num() == 0 && Texts.Num() == 0; }
+
+private:
+	struct FTile
+	{
+		FVector2D Position;
+		FVector2D Size;
+		FLinearColor Color;
+	};
+
+	/** Every tile sharing a texture and blend mode, submitted as one batch. */
+	struct FTileBatch
+	{
+		const UTexture* Texture = nullptr;
+		ESimpleElementBlendMode BlendMode = SE_BLEND_Translucent;
+		TArray<FTile> Tiles;
+	};
+
+	TArray<FTileBatch> Batches;
+
+	/** Texts sorted by font so consecutive draws share the font's batch. */
+	TArray<FCanvasTextItem> Texts;
+};
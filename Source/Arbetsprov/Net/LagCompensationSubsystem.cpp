@@ -0,0 +1,248 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+
+#include "LagCompensationSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Record History"), STAT_LagCompensationRecord, STATGROUP_LagCompensation);
+DECLARE_CYCLE_STAT(TEXT("Rewound Trace"), STAT_LagCompensationTrace, STATGROUP_LagCompensation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewound Traces"), STAT_LagCompensationTraceCount, STATGROUP_LagCompensation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewound Bodies Tested"), STAT_LagCompensationBodiesTested, STATGROUP_LagCompensation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tracked Bodies"), STAT_LagCompensationTrackedBodies, STATGROUP_LagCompensation);
+
+void ULagCompensationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	FMemory::Memzero(FrameTimes);
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	Bodies.Empty();
+	BoundsRadii.Empty();
+	Samples.Empty();
+	FreeSlots.Empty();
+	FreeSlotFlags.Empty();
+	SlotByBody.Empty();
+	Head = INDEX_NONE;
+	NumFrames = 0;
+
+	Super::Deinitialize();
+}
+
+bool ULagCompensationSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	if (!World || HasAnyFlags(RF_ClassDefaultObject)) return false;
+
+	// Only servers with remote clients need a history.
+	const ENetMode NetMode = World->GetNetMode();
+	return NetMode == NM_DedicatedServer || NetMode == NM_ListenServer;
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_LagCompensation);
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRecord);
+
+	Head = (Head + 1) % HISTORY_LENGTH;
+	NumFrames = FMath::Min(NumFrames + 1, HISTORY_LENGTH);
+	FrameTimes[Head] = GetWorld()->GetTimeSeconds();
+
+	for (int32 Slot = 0; Slot < Bodies.Num(); ++Slot)
+	{
+		const UPrimitiveComponent* Component = Bodies[Slot].Get();
+		if (!Component)
+		{
+			// Free the slot of a destroyed body.
+			if (!FreeSlotFlags[Slot])
+			{
+				SlotByBody.Remove(Bodies[Slot]);
+				FreeSlots.Add(Slot);
+				FreeSlotFlags[Slot] = true;
+				DEC_DWORD_STAT(STAT_LagCompensationTrackedBodies);
+			}
+			continue;
+		}
+
+		const FTransform& Transform = Component->GetComponentTransform();
+		FRewindSample& Sample = Samples[SampleIndex(Slot, Head)];
+		Sample.Location = Transform.GetLocation();
+		Sample.Rotation = Transform.GetRotation();
+	}
+}
+
+bool ULagCompensationSubsystem::RegisterBody(UPrimitiveComponent* Component)
+{
+	if (!Component) return false;
+	if (SlotByBody.Contains(Component)) return true;
+
+	int32 Slot = INDEX_NONE;
+	if (FreeSlots.Num() > 0)
+	{
+		Slot = FreeSlots.Pop(false);
+		FreeSlotFlags[Slot] = false;
+	}
+	else if (Bodies.Num() < MAX_TRACKED_BODIES)
+	{
+		Slot = Bodies.AddDefaulted();
+		BoundsRadii.AddZeroed();
+		FreeSlotFlags.Add(false);
+		Samples.AddUninitialized(HISTORY_LENGTH);
+	}
+	else
+	{
+		return false;
+	}
+
+	const FTransform& Transform = Component->GetComponentTransform();
+	Bodies[Slot] = Component;
+	BoundsRadii[Slot] = Component->Bounds.SphereRadius + FVector::Distance(Component->Bounds.Origin, Transform.GetLocation());
+	SlotByBody.Add(Component, Slot);
+
+	// The body's past before registration is unknown, assume it was where it is now.
+	for (int32 Frame = 0; Frame < HISTORY_LENGTH; ++Frame)
+	{
+		FRewindSample& Sample = Samples[SampleIndex(Slot, Frame)];
+		Sample.Location = Transform.GetLocation();
+		Sample.Rotation = Transform.GetRotation();
+	}
+
+	INC_DWORD_STAT(STAT_LagCompensationTrackedBodies);
+
+	return true;
+}
+
+void ULagCompensationSubsystem::UnregisterBody(UPrimitiveComponent* Component)
+{
+	int32 Slot = INDEX_NONE;
+	if (SlotByBody.RemoveAndCopyValue(Component, Slot))
+	{
+		Bodies[Slot] = nullptr;
+		FreeSlots.Add(Slot);
+		FreeSlotFlags[Slot] = true;
+		DEC_DWORD_STAT(STAT_LagCompensationTrackedBodies);
+	}
+}
+
+bool ULagCompensationSubsystem::LineTraceSingleByChannelAtTime(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, float Timestamp)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationTrace);
+	INC_DWORD_STAT(STAT_LagCompensationTraceCount);
+
+	int32 Older, Newer;
+	float Alpha;
+	if (!FindFrames(Timestamp, Older, Newer, Alpha))
+	{
+		// Nothing to rewind, the present is as recent as the timestamp.
+		return GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, TraceChannel, Params);
+	}
+
+	// Trace untracked geometry at the present time.
+	RewindParams = Params;
+	for (const TPair<TWeakObjectPtr<UPrimitiveComponent>, int32>& Pair : SlotByBody)
+	{
+		RewindParams.AddIgnoredComponent(Pair.Key.Get());
+	}
+
+	bool bHit = GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, TraceChannel, RewindParams);
+
+	// Trace tracked bodies where they were by moving the ray into their present space instead of moving the bodies.
+	for (int32 Slot = 0; Slot < Bodies.Num(); ++Slot)
+	{
+		UPrimitiveComponent* Component = Bodies[Slot].Get();
+		if (!Component || Component->GetCollisionResponseToChannel(TraceChannel) != ECR_Block) continue;
+		if (Params.GetIgnoredComponents().Contains(Component->GetUniqueID())) continue;
+
+		FTransform Past = InterpolateSample(Slot, Older, Newer, Alpha);
+		if (FMath::PointDistToSegmentSquared(Past.GetLocation(), Start, End) > FMath::Square(BoundsRadii[Slot])) continue;
+
+		INC_DWORD_STAT(STAT_LagCompensationBodiesTested);
+
+		const FTransform& Present = Component->GetComponentTransform();
+		Past.SetScale3D(Present.GetScale3D());
+
+		const FVector PresentStart = Present.TransformPosition(Past.InverseTransformPosition(Start));
+		const FVector PresentEnd = Present.TransformPosition(Past.InverseTransformPosition(End));
+
+		FHitResult BodyHit;
+		if (Component->LineTraceComponent(BodyHit, PresentStart, PresentEnd, Params) && (!bHit || BodyHit.Time < OutHit.Time))
+		{
+			// Move the hit back into the rewound space.
+			BodyHit.TraceStart = Start;
+			BodyHit.TraceEnd = End;
+			BodyHit.Location = Past.TransformPosition(Present.InverseTransformPosition(BodyHit.Location));
+			BodyHit.ImpactPoint = Past.TransformPosition(Present.InverseTransformPosition(BodyHit.ImpactPoint));
+			BodyHit.Normal = Past.TransformVectorNoScale(Present.InverseTransformVectorNoScale(BodyHit.Normal));
+			BodyHit.ImpactNormal = Past.TransformVectorNoScale(Present.InverseTransformVectorNoScale(BodyHit.ImpactNormal));
+			BodyHit.bBlockingHit = true;
+
+			OutHit = BodyHit;
+			bHit = true;
+		}
+	}
+
+	return bHit;
+}
+
+bool ULagCompensationSubsystem::GetTransformAtTime(const UPrimitiveComponent* Component, float Timestamp, FTransform& OutTransform) const
+{
+	const int32* Slot = SlotByBody.Find(const_cast<UPrimitiveComponent*>(Component));
+	if (!Slot) return false;
+
+	int32 Older, Newer;
+	float Alpha;
+	if (FindFrames(Timestamp, Older, Newer, Alpha))
+	{
+		OutTransform = InterpolateSample(*Slot, Older, Newer, Alpha);
+		OutTransform.SetScale3D(Component->GetComponentScale());
+	}
+	else
+	{
+		OutTransform = Component->GetComponentTransform();
+	}
+
+	return true;
+}
+
+bool ULagCompensationSubsystem::FindFrames(float Timestamp, int32& OutOlder, int32& OutNewer, float& OutAlpha) const
+{
+	if (NumFrames == 0 || Timestamp >= FrameTimes[Head]) return false;
+
+	// Walk backwards from the most recent frame, the timestamp is usually only a few frames old.
+	for (int32 Age = 1; Age < NumFrames; ++Age)
+	{
+		const int32 Newer = (Head - Age + 1 + HISTORY_LENGTH) % HISTORY_LENGTH;
+		const int32 Older = (Head - Age + HISTORY_LENGTH) % HISTORY_LENGTH;
+		if (FrameTimes[Older] <= Timestamp)
+		{
+			OutOlder = Older;
+			OutNewer = Newer;
+			OutAlpha = (Timestamp - FrameTimes[Older]) / FMath::Max(FrameTimes[Newer] - FrameTimes[Older], SMALL_NUMBER);
+			return true;
+		}
+	}
+
+	// Older than the history, clamp to the oldest frame.
+	OutOlder = OutNewer = (Head - NumFrames + 1 + HISTORY_LENGTH) % HISTORY_LENGTH;
+	OutAlpha = 0.f;
+
+	return true;
+}
+
+FTransform ULagCompensationSubsystem::InterpolateSample(int32 Slot, int32 Older, int32 Newer, float Alpha) const
+{
+	const FRewindSample& From = Samples[SampleIndex(Slot, Older)];
+	const FRewindSample& To = Samples[SampleIndex(Slot, Newer)];
+
+	return FTransform(
+		FQuat::Slerp(From.Rotation, To.Rotation, Alpha),
+		FMath::Lerp(From.Location, To.Location, Alpha)
+	);
+}
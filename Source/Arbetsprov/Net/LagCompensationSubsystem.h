@@ -0,0 +1,129 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Stats/Stats.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class UPrimitiveComponent;
+
+DECLARE_STATS_GROUP(TEXT("LagCompensation"), STATGROUP_LagCompensation, STATCAT_Advanced);
+
+/**
+ * Records the recent transforms of tracked bodies on the server so traces can be evaluated
+ * against the world as a client saw it, without moving bodies or re-running physics.
+ * History is a fixed amount of frames per body, so memory is bounded by MAX_TRACKED_BODIES * HISTORY_LENGTH samples.
+ */
+UCLASS()
+class ARBETSPROV_API ULagCompensationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	/**
+	 * Starts recording the transform of a body.
+	 * @param Component - The body to track.
+	 * @return Whether or not the body is tracked, false if there is no free slot.
+	 */
+	bool RegisterBody(UPrimitiveComponent* Component);
+
+	/**
+	 * Stops recording the transform of a body.
+	 * @param Component - The body to stop tracking.
+	 */
+	void UnregisterBody(UPrimitiveComponent* Component);
+
+	/**
+	 * Linetrace against the world with tracked bodies where they were at a point in time.
+	 * Untracked geometry is traced at the present time.
+	 * @param OutHit - Upon return will contain the result of the linetrace, with locations in the rewound space.
+	 * @param Start - Start of the linetrace.
+	 * @param End - End of the linetrace.
+	 * @param TraceChannel - The channel to check.
+	 * @param Params - Collision query params of the linetrace.
+	 * @param Timestamp - Server world time to rewind to, e.g. the time the client saw when firing.
+	 * @return Whether or not something was hit by the linetrace.
+	 */
+	bool LineTraceSingleByChannelAtTime(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, float Timestamp);
+
+	/**
+	 * Gets the transform a tracked body had at a point in time, interpolating between recorded frames.
+	 * @param Component - The tracked body.
+	 * @param Timestamp - Server world time to rewind to.
+	 * @param OutTransform - Upon return will contain the rewound transform.
+	 * @return Whether or not the body is tracked.
+	 */
+	bool GetTransformAtTime(const UPrimitiveComponent* Component, float Timestamp, FTransform& OutTransform) const;
+
+	/** Amount of frames recorded per body. */
+	static constexpr int32 HISTORY_LENGTH = 32;
+
+	/** Maximum amount of bodies tracked at once. */
+	static constexpr int32 MAX_TRACKED_BODIES = 256;
+
+private:
+	/** A recorded transform, kept small and without scale since tracked bodies don't change scale. */
+	struct FRewindSample
+	{
+		FVector Location;
+		FQuat Rotation;
+	};
+
+	/**
+	 * Finds the recorded frames surrounding a point in time.
+	 * @param Timestamp - Server world time to look up.
+	 * @param OutOlder - Ring index of the frame at or before the timestamp.
+	 * @param OutNewer - Ring index of the frame after the timestamp.
+	 * @param OutAlpha - Interpolation factor between the two frames.
+	 * @return Whether or not the timestamp is inside the recorded history.
+	 */
+	bool FindFrames(float Timestamp, int32& OutOlder, int32& OutNewer, float& OutAlpha) const;
+
+	/** Interpolates the sample of a slot between two frames. */
+	FTransform InterpolateSample(int32 Slot, int32 Older, int32 Newer, float Alpha) const;
+
+	/** Returns the index of a sample in Samples. */
+	FORCEINLINE static int32 SampleIndex(int32 Slot, int32 Frame) { return Slot * HISTORY_LENGTH + Frame; }
+
+	/** Tracked bodies by slot, stale entries are free slots. */
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> Bodies;
+
+	/** Bounding sphere radius by slot, used to skip bodies the ray doesn't pass near. */
+	TArray<float> BoundsRadii;
+
+	/** Samples of every slot, contiguous per slot so a lookup touches two neighbouring entries. */
+	TArray<FRewindSample> Samples;
+
+	/** Server world time of every recorded frame, shared by all slots. */
+	float FrameTimes[HISTORY_LENGTH];
+
+	TArray<int32> FreeSlots;
+
+	/** Whether each slot is in FreeSlots, so freeing stale slots doesn't search it. */
+	TBitArray<> FreeSlotFlags;
+
+	TMap<TWeakObjectPtr<UPrimitiveComponent>, int32> SlotByBody;
+
+	/** Ring index of the most recent frame. */
+	int32 Head = INDEX_NONE;
+
+	/** Amount of frames recorded so far, up to HISTORY_LENGTH. */
+	int32 NumFrames = 0;
+
+	/** Collision query params of the world trace, the caller's params with every tracked body ignored. Kept to reuse its memory. */
+	FCollisionQueryParams RewindParams;
+};
@@ -0,0 +1,124 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+
+/** The physics state of one body, written compactly: sleeping bodies store no velocities, bodies nobody holds no holder. */
+struct FBodySnapshot
+{
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector LinearVelocity = FVector::ZeroVector;
+	/** Angular velocity in degrees per second. */
+	FVector AngularVelocity = FVector::ZeroVector;
+	bool bAwake = false;
+	/** Index of the gravity gun holding the body in the snapshot that owns it, INDEX_NONE if nobody holds it. */
+	int32 Holder = INDEX_NONE;
+
+	/** Transforms closer than these are considered unchanged by delta restores. */
+	static constexpr float LOCATION_TOLERANCE = 0.1f;
+	static constexpr float ROTATION_TOLERANCE = 1.e-3f;
+	static constexpr float VELOCITY_TOLERANCE = 0.1f;
+
+	/**
+	 * Captures the state of a component.
+	 * @param Component - The component to capture.
+	 * @return The state, without a holder.
+	 */
+	static FBodySnapshot Capture(const UPrimitiveComponent* Component)
+	{
+		FBodySnapshot Snapshot;
+		Snapshot.Location = Component->GetComponentLocation();
+		Snapshot.Rotation = Component->GetComponentQuat();
+		Snapshot.bAwake = Component->IsSimulatingPhysics() && Component->RigidBodyIsAwake();
+
+		if (Snapshot.bAwake)
+		{
+			Snapshot.LinearVelocity = Component->GetPhysicsLinearVelocity();
+			Snapshot.AngularVelocity = Component->GetPhysicsAngularVelocityInDegrees();
+		}
+
+		return Snapshot;
+	}
+
+	/**
+	 * Moves a component to the state, teleporting it and setting its velocities and sleep state.
+	 * @param Component - The component to move.
+	 */
+	void Apply(UPrimitiveComponent* Component) const
+	{
+		Component->SetWorldLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+		if (!Component->IsSimulatingPhysics()) return;
+
+		Component->SetPhysicsLinearVelocity(LinearVelocity);
+		Component->SetPhysicsAngularVelocityInDegrees(AngularVelocity);
+
+		if (bAwake)
+		{
+			Component->WakeRigidBody();
+		}
+		else
+		{
+			Component->PutRigidBodyToSleep();
+		}
+	}
+
+	/**
+	 * Whether or not a transform is where the snapshot has the body, within tolerance.
+	 * @param Transform - The transform to compare.
+	 */
+	bool MatchesTransform(const FTransform& Transform) const
+	{
+		return Transform.GetLocation().Equals(Location, LOCATION_TOLERANCE) && Transform.GetRotation().Equals(Rotation, ROTATION_TOLERANCE);
+	}
+
+	/**
+	 * Whether or not a component is in the state, within tolerance, so a delta restore can skip it.
+	 * @param Component - The component to compare.
+	 */
+	bool Matches(const UPrimitiveComponent* Component) const
+	{
+		const bool bComponentAwake = Component->IsSimulatingPhysics() && Component->RigidBodyIsAwake();
+		if (bComponentAwake != bAwake || !MatchesTransform(Component->GetComponentTransform())) return false;
+
+		// Two sleeping bodies at the same place are the same, awake ones also have to move the same way.
+		return !bAwake
+			|| (Component->GetPhysicsLinearVelocity().Equals(LinearVelocity, VELOCITY_TOLERANCE)
+				&& Component->GetPhysicsAngularVelocityInDegrees().Equals(AngularVelocity, VELOCITY_TOLERANCE));
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FBodySnapshot& Snapshot)
+	{
+		enum : uint8 { FLAG_AWAKE = 1 << 0, FLAG_HELD = 1 << 1 };
+
+		uint8 Flags = (Snapshot.bAwake ? FLAG_AWAKE : 0) | (Snapshot.Holder != INDEX_NONE ? FLAG_HELD : 0);
+		Ar << Flags;
+		Ar << Snapshot.Location;
+		Ar << Snapshot.Rotation;
+
+		if (Ar.IsLoading())
+		{
+			Snapshot.bAwake = (Flags & FLAG_AWAKE) != 0;
+			Snapshot.LinearVelocity = FVector::ZeroVector;
+			Snapshot.AngularVelocity = FVector::ZeroVector;
+			Snapshot.Holder = INDEX_NONE;
+		}
+
+		if (Flags & FLAG_AWAKE)
+		{
+			Ar << Snapshot.LinearVelocity;
+			Ar << Snapshot.AngularVelocity;
+		}
+
+		if (Flags & FLAG_HELD)
+		{
+			uint16 Holder = uint16(Snapshot.Holder);
+			Ar << Holder;
+			Snapshot.Holder = Holder;
+		}
+
+		return Ar;
+	}
+};
@@ -0,0 +1,570 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+
+#include "GrabbablePropManager.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Net/LagCompensationSubsystem.h"
+#include "Net/UnrealNetwork.h"
+#include "WorldCollision.h"
+
+AGrabbablePropManager::AGrabbablePropManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickInterval = 0.1f;
+
+	IdleInstances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("Idle Instances"));
+	IdleInstances->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	// Blocks like static geometry, but overlaps for physics bodies, e.g. the tractor beam, should find the instances.
+	IdleInstances->SetCollisionObjectType(ECollisionChannel::ECC_PhysicsBody);
+	IdleInstances->SetMobility(EComponentMobility::Movable);
+	SetRootComponent(IdleInstances);
+
+	bReplicates = true;
+	// Relevancy measured from where the manager was placed would cull props that are next to the viewer.
+	bAlwaysRelevant = true;
+	NetDormancy = DORM_DormantAll;
+	NetUpdateFrequency = 10.f;
+	ReplicatedProps.Owner = this;
+}
+
+void AGrabbablePropManager::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AGrabbablePropManager, ReplicatedProps);
+}
+
+float AGrabbablePropManager::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	float NearestDistanceSquared = NetCullDistanceSquared;
+	for (const int32 PropId : ActiveProps)
+	{
+		if (const UStaticMeshComponent* Component = Props[PropId].Component)
+		{
+			NearestDistanceSquared = FMath::Min(NearestDistanceSquared, FVector::DistSquared(ViewPos, Component->GetComponentLocation()));
+		}
+	}
+
+	// Full priority next to the viewer down to a fifth at the cull distance, like distant actors get by default.
+	const float Alpha = FMath::Sqrt(NearestDistanceSquared / FMath::Max(NetCullDistanceSquared, 1.f));
+	return NetPriority * Time * FMath::Lerp(1.f, 0.2f, Alpha);
+}
+
+void AGrabbablePropManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ReplicatedProps.Owner = this;
+
+	if (PropMesh)
+	{
+		IdleInstances->SetStaticMesh(PropMesh);
+		IdleInstances->SetMaterial(0, PropMaterial);
+	}
+
+	if (bAbsorbMatchingActors)
+	{
+		AbsorbMatchingActors();
+	}
+}
+
+void AGrabbablePropManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// Iterate backwards since demoting removes from ActiveProps.
+	for (int32 i = ActiveProps.Num() - 1; i >= 0; --i)
+	{
+		const FGrabbableProp& Prop = Props[ActiveProps[i]];
+		if (!Prop.bServerDriven && !Prop.bHeld && Now - Prop.PromotionTime >= MinActiveTime && !Prop.Component->RigidBodyIsAwake())
+		{
+			DemoteProp(ActiveProps[i]);
+		}
+	}
+
+	if (HasAuthority())
+	{
+		UpdateReplicatedProps();
+	}
+}
+
+int32 AGrabbablePropManager::AddProp(const FTransform& Transform)
+{
+	FGrabbableProp Prop;
+	Prop.InstanceIndex = IdleInstances->AddInstanceWorldSpace(Transform);
+
+	const int32 PropId = Props.Add(Prop);
+	InstanceToProp.Add(PropId);
+
+	return PropId;
+}
+
+UStaticMeshComponent* AGrabbablePropManager::PromoteInstance(int32 InstanceIndex)
+{
+	if (!InstanceToProp.IsValidIndex(InstanceIndex)) return nullptr;
+
+	return PromoteProp(InstanceToProp[InstanceIndex]);
+}
+
+UStaticMeshComponent* AGrabbablePropManager::PromoteProp(int32 PropId)
+{
+	if (!Props.IsValidIndex(PropId)) return nullptr;
+	if (Props[PropId].Component) return Props[PropId].Component;
+
+	UStaticMeshComponent* Component = AcquireComponent();
+	if (!Component) return nullptr;
+
+	const int32 InstanceIndex = Props[PropId].InstanceIndex;
+
+	FTransform Transform;
+	IdleInstances->GetInstanceTransform(InstanceIndex, Transform, true);
+	RemoveInstanceSwap(InstanceIndex);
+
+	Component->SetWorldTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+	Component->SetVisibility(true);
+	Component->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	Component->SetSimulatePhysics(true);
+	Component->WakeRigidBody();
+
+	FGrabbableProp& Prop = Props[PropId];
+	Prop.InstanceIndex = INDEX_NONE;
+	Prop.Component = Component;
+	Prop.PromotionTime = GetWorld()->GetTimeSeconds();
+	Prop.bHeld = false;
+	Prop.bServerDriven = false;
+
+	ActiveProps.Add(PropId);
+	ComponentToProp.Add(Component, PropId);
+
+	if (HasAuthority())
+	{
+		FReplicatedProp& ReplicatedProp = FindOrAddReplicatedProp(PropId);
+		ReplicatedProp.SetTransform(Transform);
+		ReplicatedProp.bResting = false;
+		ReplicatedProps.MarkItemDirty(ReplicatedProp);
+
+		SetNetDormancy(DORM_Awake);
+
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterBody(Component);
+		}
+	}
+
+	return Component;
+}
+
+void AGrabbablePropManager::PrewarmComponents(int32 Count)
+{
+	Count = FMath::Min(Count, MaxActiveProps);
+	while (ComponentPool.Num() < Count)
+	{
+		// Always creates, acquiring would hand back the component just released.
+		UStaticMeshComponent* Component = CreatePooledComponent();
+		if (!Component) break;
+
+		ReleaseComponent(Component);
+	}
+}
+
+void AGrabbablePropManager::CapturePropStates(TArray<FBodySnapshot>& OutStates) const
+{
+	OutStates.SetNum(Props.Num());
+
+	for (int32 PropId = 0; PropId < Props.Num(); ++PropId)
+	{
+		const FGrabbableProp& Prop = Props[PropId];
+		if (Prop.Component)
+		{
+			OutStates[PropId] = FBodySnapshot::Capture(Prop.Component);
+		}
+		else
+		{
+			FTransform Transform;
+			IdleInstances->GetInstanceTransform(Prop.InstanceIndex, Transform, true);
+
+			FBodySnapshot& State = OutStates[PropId];
+			State = FBodySnapshot();
+			State.Location = Transform.GetLocation();
+			State.Rotation = Transform.GetRotation();
+		}
+	}
+}
+
+int32 AGrabbablePropManager::RestorePropStates(const TArray<FBodySnapshot>& States, bool bDeltaOnly, int32& OutNumSkipped)
+{
+	const bool bReplicate = HasAuthority() && GetNetMode() != NM_Standalone;
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	int32 NumRestored = 0;
+	bool bInstancesMoved = false;
+	bool bRestingPropsMoved = false;
+	OutNumSkipped = 0;
+
+	const int32 NumStates = FMath::Min(States.Num(), Props.Num());
+	for (int32 PropId = 0; PropId < NumStates; ++PropId)
+	{
+		const FBodySnapshot& State = States[PropId];
+		const bool bHeld = State.Holder != INDEX_NONE;
+
+		if (!Props[PropId].Component)
+		{
+			FTransform Transform;
+			IdleInstances->GetInstanceTransform(Props[PropId].InstanceIndex, Transform, true);
+			if (bDeltaOnly && !State.bAwake && !bHeld && State.MatchesTransform(Transform)) continue;
+
+			if (!State.bAwake && !bHeld)
+			{
+				Transform.SetLocation(State.Location);
+				Transform.SetRotation(State.Rotation);
+				IdleInstances->UpdateInstanceTransform(Props[PropId].InstanceIndex, Transform, true, false, true);
+				bInstancesMoved = true;
+				++NumRestored;
+
+				if (bReplicate)
+				{
+					ReplicateRestingProp(PropId, Transform);
+					bRestingPropsMoved = true;
+				}
+				continue;
+			}
+
+			// Out of components, leave the prop where it is and let the caller know.
+			if (!PromoteProp(PropId))
+			{
+				++OutNumSkipped;
+				continue;
+			}
+		}
+		else if (bDeltaOnly && !bHeld && State.Matches(Props[PropId].Component))
+		{
+			continue;
+		}
+
+		FGrabbableProp& Prop = Props[PropId];
+		State.Apply(Prop.Component);
+		Prop.PromotionTime = Now;
+		++NumRestored;
+
+		if (!State.bAwake && !bHeld && !Prop.bHeld)
+		{
+			DemoteProp(PropId);
+			bInstancesMoved = true;
+			bRestingPropsMoved |= bReplicate;
+		}
+	}
+
+	if (bInstancesMoved)
+	{
+		IdleInstances->MarkRenderStateDirty();
+	}
+
+	// The manager may be dormant with every prop asleep, send the new resting transforms anyway.
+	if (bRestingPropsMoved)
+	{
+		FlushNetDormancy();
+	}
+
+	return NumRestored;
+}
+
+UStaticMeshComponent* AGrabbablePropManager::GetPropComponent(int32 PropId) const
+{
+	return Props.IsValidIndex(PropId) ? Props[PropId].Component : nullptr;
+}
+
+int32 AGrabbablePropManager::FindPropId(const UPrimitiveComponent* Component) const
+{
+	const int32* PropId = ComponentToProp.Find(Cast<UStaticMeshComponent>(const_cast<UPrimitiveComponent*>(Component)));
+
+	return PropId ? *PropId : INDEX_NONE;
+}
+
+void AGrabbablePropManager::SetPropHeld(UPrimitiveComponent* Component, bool bHeld)
+{
+	const int32* PropId = ComponentToProp.Find(Cast<UStaticMeshComponent>(Component));
+	if (PropId)
+	{
+		Props[*PropId].bHeld = bHeld;
+		Props[*PropId].PromotionTime = GetWorld()->GetTimeSeconds();
+	}
+}
+
+bool AGrabbablePropManager::PromoteHit(FHitResult& Hit)
+{
+	AGrabbablePropManager* Manager = Cast<AGrabbablePropManager>(Hit.GetActor());
+	if (!Manager || Hit.GetComponent() != Manager->IdleInstances) return false;
+
+	UStaticMeshComponent* Component = Manager->PromoteInstance(Hit.Item);
+	if (!Component) return false;
+
+	Hit.Component = Component;
+	Hit.Item = INDEX_NONE;
+
+	return true;
+}
+
+bool AGrabbablePropManager::PromoteOverlap(FOverlapResult& Overlap)
+{
+	AGrabbablePropManager* Manager = Cast<AGrabbablePropManager>(Overlap.GetActor());
+	if (!Manager || Overlap.GetComponent() != Manager->IdleInstances) return false;
+
+	UStaticMeshComponent* Component = Manager->PromoteInstance(Overlap.ItemIndex);
+	if (!Component) return false;
+
+	Overlap.Component = Component;
+	Overlap.ItemIndex = INDEX_NONE;
+
+	return true;
+}
+
+void AGrabbablePropManager::NotifyHeld(UPrimitiveComponent* Component, bool bHeld)
+{
+	AGrabbablePropManager* Manager = Component ? Cast<AGrabbablePropManager>(Component->GetOwner()) : nullptr;
+	if (Manager)
+	{
+		Manager->SetPropHeld(Component, bHeld);
+	}
+}
+
+void AGrabbablePropManager::AbsorbMatchingActors()
+{
+	if (!PropMesh) return;
+
+	TArray<AStaticMeshActor*> Absorbed;
+	for (TActorIterator<AStaticMeshActor> It(GetWorld()); It; ++It)
+	{
+		const UStaticMeshComponent* MeshComponent = It->GetStaticMeshComponent();
+		if (MeshComponent && MeshComponent->GetStaticMesh() == PropMesh && MeshComponent->IsSimulatingPhysics())
+		{
+			AddProp(MeshComponent->GetComponentTransform());
+			Absorbed.Add(*It);
+		}
+	}
+
+	for (AStaticMeshActor* Actor : Absorbed)
+	{
+		Actor->Destroy();
+	}
+}
+
+void AGrabbablePropManager::DemoteProp(int32 PropId)
+{
+	FGrabbableProp& Prop = Props[PropId];
+	if (!Prop.Component) return;
+
+	const FTransform& Transform = Prop.Component->GetComponentTransform();
+	Prop.InstanceIndex = IdleInstances->AddInstanceWorldSpace(Transform);
+	InstanceToProp.Add(PropId);
+
+	if (HasAuthority())
+	{
+		ReplicateRestingProp(PropId, Transform);
+	}
+
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterBody(Prop.Component);
+	}
+
+	ComponentToProp.Remove(Prop.Component);
+	ReleaseComponent(Prop.Component);
+	Prop.Component = nullptr;
+
+	ActiveProps.RemoveSingleSwap(PropId, false);
+}
+
+void AGrabbablePropManager::UpdateReplicatedProps()
+{
+	const float ToleranceSquared = FMath::Square(ReplicationLocationTolerance);
+
+	for (const int32 PropId : ActiveProps)
+	{
+		const UStaticMeshComponent* Component = Props[PropId].Component;
+		FReplicatedProp& ReplicatedProp = ReplicatedProps.Items[ReplicatedPropIndices[PropId]];
+
+		const FTransform& Transform = Component->GetComponentTransform();
+		const FRotator Rotation = Transform.Rotator();
+		const bool bMoved = FVector::DistSquared(Transform.GetLocation(), ReplicatedProp.Location) > ToleranceSquared
+			|| FRotator::CompressAxisToShort(Rotation.Pitch) != ReplicatedProp.Pitch
+			|| FRotator::CompressAxisToShort(Rotation.Yaw) != ReplicatedProp.Yaw
+			|| FRotator::CompressAxisToShort(Rotation.Roll) != ReplicatedProp.Roll;
+
+		if (bMoved)
+		{
+			ReplicatedProp.SetTransform(Transform);
+			ReplicatedProps.MarkItemDirty(ReplicatedProp);
+		}
+	}
+
+	// Once every prop is asleep nothing needs replicating, the pending rest transforms are still sent before the channel goes dormant.
+	if (ActiveProps.Num() == 0 && NetDormancy != DORM_DormantAll)
+	{
+		SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+FReplicatedProp& AGrabbablePropManager::FindOrAddReplicatedProp(int32 PropId)
+{
+	while (ReplicatedPropIndices.Num() <= PropId)
+	{
+		ReplicatedPropIndices.Add(INDEX_NONE);
+	}
+
+	// Entries are never removed, so the indices stay valid.
+	if (ReplicatedPropIndices[PropId] == INDEX_NONE)
+	{
+		ReplicatedPropIndices[PropId] = ReplicatedProps.Items.AddDefaulted();
+		ReplicatedProps.Items[ReplicatedPropIndices[PropId]].PropId = PropId;
+	}
+
+	return ReplicatedProps.Items[ReplicatedPropIndices[PropId]];
+}
+
+void AGrabbablePropManager::ReplicateRestingProp(int32 PropId, const FTransform& Transform)
+{
+	// Where the prop rests is kept in the replicated entry, the instances themselves don't replicate.
+	FReplicatedProp& ReplicatedProp = FindOrAddReplicatedProp(PropId);
+	ReplicatedProp.SetTransform(Transform);
+	ReplicatedProp.bResting = true;
+	ReplicatedProps.MarkItemDirty(ReplicatedProp);
+}
+
+void AGrabbablePropManager::ApplyReplicatedProp(const FReplicatedProp& ReplicatedProp)
+{
+	if (!Props.IsValidIndex(ReplicatedProp.PropId)) return;
+
+	FGrabbableProp& Prop = Props[ReplicatedProp.PropId];
+
+	if (ReplicatedProp.bResting)
+	{
+		if (Prop.Component)
+		{
+			Prop.Component->SetWorldTransform(ReplicatedProp.GetTransform(Prop.Component->GetComponentScale()), false, nullptr, ETeleportType::TeleportPhysics);
+			DemoteProp(ReplicatedProp.PropId);
+		}
+		else
+		{
+			FTransform Transform;
+			IdleInstances->GetInstanceTransform(Prop.InstanceIndex, Transform, true);
+			IdleInstances->UpdateInstanceTransform(Prop.InstanceIndex, ReplicatedProp.GetTransform(Transform.GetScale3D()), true, true, true);
+		}
+		return;
+	}
+
+	UStaticMeshComponent* Component = PromoteProp(ReplicatedProp.PropId);
+	if (!Component) return;
+
+	// Clients follow the server instead of simulating the prop themselves.
+	Props[ReplicatedProp.PropId].bServerDriven = true;
+	Component->SetSimulatePhysics(false);
+	Component->SetWorldTransform(ReplicatedProp.GetTransform(Component->GetComponentScale()), false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void AGrabbablePropManager::RemoveInstanceSwap(int32 InstanceIndex)
+{
+	const int32 LastIndex = InstanceToProp.Num() - 1;
+	if (InstanceIndex != LastIndex)
+	{
+		FTransform LastTransform;
+		IdleInstances->GetInstanceTransform(LastIndex, LastTransform, true);
+		IdleInstances->UpdateInstanceTransform(InstanceIndex, LastTransform, true, false, true);
+
+		InstanceToProp[InstanceIndex] = InstanceToProp[LastIndex];
+		Props[InstanceToProp[InstanceIndex]].InstanceIndex = InstanceIndex;
+	}
+
+	// Removing the last instance doesn't shift any other index.
+	IdleInstances->RemoveInstance(LastIndex);
+	InstanceToProp.Pop(false);
+}
+
+UStaticMeshComponent* AGrabbablePropManager::AcquireComponent()
+{
+	if (FreeComponents.Num() > 0)
+	{
+		return FreeComponents.Pop(false);
+	}
+
+	return CreatePooledComponent();
+}
+
+UStaticMeshComponent* AGrabbablePropManager::CreatePooledComponent()
+{
+	if (ComponentPool.Num() >= MaxActiveProps) return nullptr;
+
+	UStaticMeshComponent* Component = NewObject<UStaticMeshComponent>(this);
+	Component->SetMobility(EComponentMobility::Movable);
+	Component->SetStaticMesh(PropMesh);
+	Component->SetMaterial(0, PropMaterial);
+	Component->SetCollisionProfileName(UCollisionProfile::PhysicsActor_ProfileName);
+	Component->SetNotifyRigidBodyCollision(true);
+	Component->OnComponentHit.AddDynamic(this, &AGrabbablePropManager::OnActivePropHit);
+	Component->RegisterComponent();
+
+	ComponentPool.Add(Component);
+
+	return Component;
+}
+
+void AGrabbablePropManager::ReleaseComponent(UStaticMeshComponent* Component)
+{
+	Component->SetSimulatePhysics(false);
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->SetVisibility(false);
+
+	FreeComponents.Add(Component);
+}
+
+void AGrabbablePropManager::OnActivePropHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+{
+	if (OtherComp == IdleInstances)
+	{
+		PromoteInstance(Hit.Item);
+	}
+}
+
+void FReplicatedProp::SetTransform(const FTransform& Transform)
+{
+	const FRotator Rotation = Transform.Rotator();
+
+	Location = Transform.GetLocation();
+	Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+	Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+	Roll = FRotator::CompressAxisToShort(Rotation.Roll);
+}
+
+FTransform FReplicatedProp::GetTransform(const FVector& Scale) const
+{
+	const FRotator Rotation(
+		FRotator::DecompressAxisFromShort(Pitch),
+		FRotator::DecompressAxisFromShort(Yaw),
+		FRotator::DecompressAxisFromShort(Roll)
+	);
+
+	return FTransform(Rotation, Location, Scale);
+}
+
+void FReplicatedProp::PostReplicatedAdd(const FReplicatedPropArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->ApplyReplicatedProp(*this);
+	}
+}
+
+void FReplicatedProp::PostReplicatedChange(const FReplicatedPropArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->ApplyReplicatedProp(*this);
+	}
+}
@@ -0,0 +1,311 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "GameFramework/Actor.h"
+#include "Props/BodySnapshot.h"
+#include "GrabbablePropManager.generated.h"
+
+class AGrabbablePropManager;
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+class UStaticMeshComponent;
+struct FOverlapResult;
+
+/** Quantized transform of a prop that moved, as sent to clients. */
+USTRUCT()
+struct FReplicatedProp : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 PropId = INDEX_NONE;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Location;
+
+	UPROPERTY()
+	uint16 Pitch = 0;
+	UPROPERTY()
+	uint16 Yaw = 0;
+	UPROPERTY()
+	uint16 Roll = 0;
+
+	/** Whether the prop was demoted and rests as an instance at the transform, otherwise it's active on the server. */
+	UPROPERTY()
+	bool bResting = false;
+
+	/** Quantizes and stores the transform, without scale since props keep the scale they were placed with. */
+	void SetTransform(const FTransform& Transform);
+
+	/**
+	 * Gets the stored transform.
+	 * @param Scale - The scale of the prop.
+	 * @return The transform with the given scale.
+	 */
+	FTransform GetTransform(const FVector& Scale) const;
+
+	void PostReplicatedAdd(const struct FReplicatedPropArray& InArraySerializer);
+	void PostReplicatedChange(const struct FReplicatedPropArray& InArraySerializer);
+};
+
+/**
+ * Props that moved, replicated as a delta-serialized array so only props that move are sent.
+ * Entries stay once their prop rests, so clients joining later or waking from dormancy see where props came to rest.
+ */
+USTRUCT()
+struct FReplicatedPropArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FReplicatedProp> Items;
+
+	UPROPERTY(NotReplicated)
+	AGrabbablePropManager* Owner = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FReplicatedProp, FReplicatedPropArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FReplicatedPropArray> : public TStructOpsTypeTraitsBase2<FReplicatedPropArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * Renders idle grabbable props as instances of a single instanced static mesh and promotes them
+ * to full simulating components only while something interacts with them.
+ * Sleeping props are demoted back to instances.
+ * Only props that moved are replicated, and only sent again while active, so the net cost scales with the amount of moving props.
+ * The props can be anywhere in the level, so the manager is always relevant and is prioritized by its props instead.
+ * The manager is net dormant while every prop is asleep.
+ */
+UCLASS()
+class ARBETSPROV_API AGrabbablePropManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AGrabbablePropManager();
+
+	/** Tick function. */
+	virtual void Tick(float DeltaTime) override;
+
+	/**
+	 * Adds an idle prop.
+	 * @param Transform - The world transform of the prop.
+	 * @return The id of the prop.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Props")
+	int32 AddProp(const FTransform& Transform);
+
+	/**
+	 * Promotes an idle instance to a simulating component.
+	 * @param InstanceIndex - The index of the instance, e.g. FHitResult::Item of a hit on the instances.
+	 * @return The simulating component representing the prop or nullptr if the index is invalid or no component is available.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Props")
+	UStaticMeshComponent* PromoteInstance(int32 InstanceIndex);
+
+	/**
+	 * Creates simulating components up front so the first promotions don't create them.
+	 * @param Count - The amount of components the pool should hold at least, limited by MaxActiveProps.
+	 */
+	void PrewarmComponents(int32 Count);
+
+	/**
+	 * Captures the state of every prop.
+	 * @param OutStates - Upon return will contain the state of every prop, indexed by prop id, without holders.
+	 */
+	void CapturePropStates(TArray<FBodySnapshot>& OutStates) const;
+
+	/**
+	 * Moves every prop to a captured state. Props that should be awake or held are promoted, sleeping ones demoted.
+	 * Sleeping props are sent to clients as resting props, they don't need promoting.
+	 * @param States - States indexed by prop id, as captured by CapturePropStates.
+	 * @param bDeltaOnly - Whether to skip props that are already in their state.
+	 * @param OutNumSkipped - Upon return will contain the amount of awake or held props left where they are since MaxActiveProps components were in use.
+	 * @return The amount of props that were moved.
+	 */
+	int32 RestorePropStates(const TArray<FBodySnapshot>& States, bool bDeltaOnly, int32& OutNumSkipped);
+
+	/**
+	 * Gets the simulating component of a prop.
+	 * @param PropId - The id of the prop.
+	 * @return The component or nullptr if the prop is idle.
+	 */
+	UStaticMeshComponent* GetPropComponent(int32 PropId) const;
+
+	/**
+	 * Finds the prop an active component represents.
+	 * @param Component - The component.
+	 * @return The id of the prop or INDEX_NONE if the component isn't an active prop of this manager.
+	 */
+	int32 FindPropId(const UPrimitiveComponent* Component) const;
+
+	/**
+	 * Marks an active prop as held so it isn't demoted while asleep in a physics handle.
+	 * @param Component - The component of the prop.
+	 * @param bHeld - Whether or not the prop is held.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Props")
+	void SetPropHeld(UPrimitiveComponent* Component, bool bHeld);
+
+	/**
+	 * If the hit is on the idle instances of a prop manager, promotes the instance and points the hit at the simulating component.
+	 * @param Hit - The hit to resolve, modified in place.
+	 * @return Whether or not an instance was promoted.
+	 */
+	static bool PromoteHit(FHitResult& Hit);
+
+	/**
+	 * If the overlap is on the idle instances of a prop manager, promotes the instance and points the overlap at the simulating component.
+	 * @param Overlap - The overlap to resolve, modified in place.
+	 * @return Whether or not an instance was promoted.
+	 */
+	static bool PromoteOverlap(FOverlapResult& Overlap);
+
+	/**
+	 * Marks the component as held if it is a prop owned by a prop manager.
+	 * @param Component - The component that was grabbed or released.
+	 * @param bHeld - Whether or not the component is held.
+	 */
+	static void NotifyHeld(UPrimitiveComponent* Component, bool bHeld);
+
+	/**
+	 * Moves a prop to its replicated transform, promoting it while it's active on the server and demoting it once it rests. Called on clients.
+	 * @param ReplicatedProp - The replicated state of the prop.
+	 */
+	void ApplyReplicatedProp(const FReplicatedProp& ReplicatedProp);
+
+	/** Returns the amount of props currently simulating. */
+	FORCEINLINE int32 GetNumActiveProps() const { return ActiveProps.Num(); }
+	/** Returns the total amount of props. */
+	FORCEINLINE int32 GetNumProps() const { return Props.Num(); }
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Prioritizes by the distance from the viewer to the nearest active prop, the manager's own location says nothing about its props. */
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	/** A prop is either an instance or an active component, never both. */
+	struct FGrabbableProp
+	{
+		int32 InstanceIndex = INDEX_NONE;
+		UStaticMeshComponent* Component = nullptr;
+		float PromotionTime = 0.f;
+		bool bHeld = false;
+		/** Whether the prop follows the server instead of simulating locally. */
+		bool bServerDriven = false;
+	};
+
+	/**
+	 * Promotes an idle prop to a simulating component.
+	 * @param PropId - The id of the prop.
+	 * @return The component representing the prop or nullptr if none is available.
+	 */
+	UStaticMeshComponent* PromoteProp(int32 PropId);
+
+	/** Sends the transforms of active props that moved and updates dormancy. Server only. */
+	void UpdateReplicatedProps();
+
+	/**
+	 * Gets the replicated entry of a prop, adding one the first time the prop moves. Server only.
+	 * @param PropId - The id of the prop.
+	 * @return The entry, mark it dirty after changing it.
+	 */
+	FReplicatedProp& FindOrAddReplicatedProp(int32 PropId);
+
+	/**
+	 * Sends clients where a prop rests as an instance. Server only.
+	 * @param PropId - The id of the prop.
+	 * @param Transform - Where the prop rests.
+	 */
+	void ReplicateRestingProp(int32 PropId, const FTransform& Transform);
+
+	/** Replaces matching static mesh actors in the level with instances. */
+	void AbsorbMatchingActors();
+
+	/**
+	 * Demotes an active prop back to an instance at its current transform.
+	 * @param PropId - The id of the prop to demote.
+	 */
+	void DemoteProp(int32 PropId);
+
+	/** Removes an instance by moving the last instance into its slot, keeping every other index stable. */
+	void RemoveInstanceSwap(int32 InstanceIndex);
+
+	/** Gets a free simulating component, creating one if below the limit. */
+	UStaticMeshComponent* AcquireComponent();
+
+	/** Creates a simulating component and adds it to the pool, nullptr if the pool is full. The caller releases or uses it. */
+	UStaticMeshComponent* CreatePooledComponent();
+
+	/** Disables a simulating component and returns it to the pool. */
+	void ReleaseComponent(UStaticMeshComponent* Component);
+
+	/** Promotes instances that active props bump into so stacks react to impacts. */
+	UFUNCTION()
+	void OnActivePropHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Props", meta = (AllowPrivateAccess = "True"))
+	UInstancedStaticMeshComponent* IdleInstances = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "Setup")
+	UStaticMesh* PropMesh = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "Setup")
+	UMaterialInterface* PropMaterial = nullptr;
+
+	/** Static mesh actors simulating physics with PropMesh are replaced by instances on BeginPlay. */
+	UPROPERTY(EditAnywhere, Category = "Setup")
+	bool bAbsorbMatchingActors = true;
+
+	/** Upper limit of props simulating at once, e.g. caught in a tractor beam. Components are only created as needed. */
+	UPROPERTY(EditAnywhere, Category = "Setup", meta = (ClampMin = "1"))
+	int32 MaxActiveProps = 256;
+
+	/** Minimum time a prop stays active after promotion, avoids thrashing while it's only being targeted. */
+	UPROPERTY(EditAnywhere, Category = "Setup", meta = (ClampMin = "0"))
+	float MinActiveTime = 1.f;
+
+	/** Simulating components, both in use and pooled. */
+	UPROPERTY(Transient)
+	TArray<UStaticMeshComponent*> ComponentPool;
+
+	TArray<UStaticMeshComponent*> FreeComponents;
+
+	TArray<FGrabbableProp> Props;
+
+	/** Maps instance index to prop id, mirrors the order of the instances. */
+	TArray<int32> InstanceToProp;
+
+	/** Prop ids of active props. */
+	TArray<int32> ActiveProps;
+
+	TMap<UStaticMeshComponent*, int32> ComponentToProp;
+
+	UPROPERTY(Replicated)
+	FReplicatedPropArray ReplicatedProps;
+
+	/** Index of the entry in ReplicatedProps by prop id, INDEX_NONE for props that never moved. Server only. */
+	TArray<int32> ReplicatedPropIndices;
+
+	/** Active props are only sent again when they moved further than this. */
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "0"))
+	float ReplicationLocationTolerance = 1.f;
+};
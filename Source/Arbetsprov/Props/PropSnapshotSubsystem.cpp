@@ -0,0 +1,342 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+
+#include "PropSnapshotSubsystem.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Props/GrabbablePropManager.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Weapons/GravityGun.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPropSnapshot, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Capture Snapshot"), STAT_PropSnapshotCapture, STATGROUP_PropSnapshot);
+DECLARE_CYCLE_STAT(TEXT("Restore Snapshot"), STAT_PropSnapshotRestore, STATGROUP_PropSnapshot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Restored Bodies"), STAT_PropSnapshotRestoredBodies, STATGROUP_PropSnapshot);
+
+static constexpr uint32 SNAPSHOT_MAGIC = 0x534E5350; // "PSNS"
+static constexpr uint32 SNAPSHOT_VERSION = 1;
+
+/**
+ * Whether or not a count read from an archive could fit in what's left of it, so a corrupt file can't make huge arrays.
+ * @param Ar - The archive.
+ * @param Count - The count to check.
+ */
+static bool IsPlausibleCount(const FArchive& Ar, int32 Count)
+{
+	return Count >= 0 && (!Ar.IsLoading() || Count <= Ar.TotalSize() - Ar.Tell());
+}
+
+/**
+ * Writes the name of an actor or reads it and finds the actor with that name.
+ * @param Ar - The archive.
+ * @param Actor - The actor, set to nullptr when loading if no actor has the name.
+ * @param World - The world to find the actor in when loading.
+ */
+template<typename ActorType>
+static void SerializeActorName(FArchive& Ar, TWeakObjectPtr<ActorType>& Actor, UWorld* World)
+{
+	FName Name = Actor.IsValid() ? Actor->GetFName() : NAME_None;
+	Ar << Name;
+
+	if (Ar.IsLoading())
+	{
+		Actor = nullptr;
+		for (TActorIterator<ActorType> It(World); It && Name != NAME_None; ++It)
+		{
+			if (It->GetFName() == Name)
+			{
+				Actor = *It;
+				break;
+			}
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CaptureSnapshotCommand(
+	TEXT("arbetsprov.Snapshot.Capture"),
+	TEXT("Captures every grabbable prop and dropped gun."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UPropSnapshotSubsystem* Snapshot = World ? World->GetSubsystem<UPropSnapshotSubsystem>() : nullptr)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			Snapshot->CaptureSnapshot();
+			UE_LOG(LogPropSnapshot, Display, TEXT("Captured in %.2f ms."), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs RestoreSnapshotCommand(
+	TEXT("arbetsprov.Snapshot.Restore"),
+	TEXT("Restores the captured snapshot. Pass 'delta' to only rewrite bodies that moved."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UPropSnapshotSubsystem* Snapshot = World ? World->GetSubsystem<UPropSnapshotSubsystem>() : nullptr)
+		{
+			const bool bDeltaOnly = Args.Num() > 0 && Args[0] == TEXT("delta");
+			const double StartTime = FPlatformTime::Seconds();
+			const int32 NumRestored = Snapshot->RestoreSnapshot(bDeltaOnly);
+			UE_LOG(LogPropSnapshot, Display, TEXT("Restored %d bodies in %.2f ms."), NumRestored, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs SaveSnapshotCommand(
+	TEXT("arbetsprov.Snapshot.Save"),
+	TEXT("Saves the captured snapshot to a file."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UPropSnapshotSubsystem* Snapshot = World ? World->GetSubsystem<UPropSnapshotSubsystem>() : nullptr;
+		if (Snapshot && Args.Num() > 0 && !Snapshot->SaveSnapshot(Args[0]))
+		{
+			UE_LOG(LogPropSnapshot, Warning, TEXT("Could not save a snapshot to %s."), *Args[0]);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs LoadSnapshotCommand(
+	TEXT("arbetsprov.Snapshot.Load"),
+	TEXT("Loads a snapshot from a file, restore it with arbetsprov.Snapshot.Restore."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UPropSnapshotSubsystem* Snapshot = World ? World->GetSubsystem<UPropSnapshotSubsystem>() : nullptr;
+		if (Snapshot && Args.Num() > 0 && !Snapshot->LoadSnapshot(Args[0]))
+		{
+			UE_LOG(LogPropSnapshot, Warning, TEXT("Could not load a snapshot from %s."), *Args[0]);
+		}
+	}));
+
+void UPropSnapshotSubsystem::Deinitialize()
+{
+	Managers.Empty();
+	DroppedGuns.Empty();
+	Holders.Empty();
+	bHasSnapshot = false;
+
+	Super::Deinitialize();
+}
+
+void UPropSnapshotSubsystem::CaptureSnapshot()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PropSnapshotCapture);
+
+	UWorld* World = GetWorld();
+
+	Managers.Reset();
+	DroppedGuns.Reset();
+	Holders.Reset();
+
+	TMap<const UPrimitiveComponent*, int32> HolderByComponent;
+	for (TActorIterator<AGravityGun> It(World); It; ++It)
+	{
+		if (const UPrimitiveComponent* Held = It->GetHeldComponent())
+		{
+			HolderByComponent.Add(Held, Holders.Add(*It));
+		}
+	}
+
+	for (TActorIterator<AGrabbablePropManager> It(World); It; ++It)
+	{
+		FManagerSnapshot& Snapshot = Managers.AddDefaulted_GetRef();
+		Snapshot.Manager = *It;
+		It->CapturePropStates(Snapshot.Props);
+
+		for (const TPair<const UPrimitiveComponent*, int32>& Pair : HolderByComponent)
+		{
+			const int32 PropId = It->FindPropId(Pair.Key);
+			if (PropId != INDEX_NONE)
+			{
+				Snapshot.Props[PropId].Holder = Pair.Value;
+			}
+		}
+	}
+
+	for (TActorIterator<AGun> It(World); It; ++It)
+	{
+		const UPrimitiveComponent* Body = Cast<UPrimitiveComponent>(It->GetRootComponent());
+		if (!Body || It->GetOwner() || It->GetGunState() != EGunState::Dropped) continue;
+
+		FGunSnapshot& Snapshot = DroppedGuns.AddDefaulted_GetRef();
+		Snapshot.Gun = *It;
+		Snapshot.Body = FBodySnapshot::Capture(Body);
+
+		if (const int32* Holder = HolderByComponent.Find(Body))
+		{
+			Snapshot.Body.Holder = *Holder;
+		}
+	}
+
+	bHasSnapshot = true;
+}
+
+int32 UPropSnapshotSubsystem::RestoreSnapshot(bool bDeltaOnly)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PropSnapshotRestore);
+
+	UWorld* World = GetWorld();
+	if (!bHasSnapshot || World->GetNetMode() == NM_Client) return 0;
+
+	// Release everything first so handles don't pull bodies away from their restored transforms, holds are restored last.
+	for (TActorIterator<AGravityGun> It(World); It; ++It)
+	{
+		It->ReleaseGrabbedObject();
+	}
+
+	int32 NumRestored = 0;
+	int32 NumSkipped = 0;
+	for (const FManagerSnapshot& Snapshot : Managers)
+	{
+		if (AGrabbablePropManager* Manager = Snapshot.Manager.Get())
+		{
+			int32 NumManagerSkipped = 0;
+			NumRestored += Manager->RestorePropStates(Snapshot.Props, bDeltaOnly, NumManagerSkipped);
+			NumSkipped += NumManagerSkipped;
+		}
+	}
+
+	if (NumSkipped > 0)
+	{
+		UE_LOG(LogPropSnapshot, Warning, TEXT("Restored the snapshot partially, %d awake or held props were left in place since every prop component was in use."), NumSkipped);
+	}
+
+	for (const FGunSnapshot& Snapshot : DroppedGuns)
+	{
+		// Guns picked up since the capture stay with whoever carries them.
+		AGun* Gun = Snapshot.Gun.Get();
+		UPrimitiveComponent* Body = Gun ? Cast<UPrimitiveComponent>(Gun->GetRootComponent()) : nullptr;
+		if (!Body || Gun->GetOwner() || Gun->GetGunState() != EGunState::Dropped) continue;
+		if (bDeltaOnly && Snapshot.Body.Holder == INDEX_NONE && Snapshot.Body.Matches(Body)) continue;
+
+		Snapshot.Body.Apply(Body);
+		Gun->FlushNetDormancy();
+		++NumRestored;
+	}
+
+	for (const FManagerSnapshot& Snapshot : Managers)
+	{
+		const AGrabbablePropManager* Manager = Snapshot.Manager.Get();
+		for (int32 PropId = 0; Manager && PropId < Snapshot.Props.Num(); ++PropId)
+		{
+			if (Snapshot.Props[PropId].Holder != INDEX_NONE)
+			{
+				RestoreHold(Snapshot.Props[PropId].Holder, Manager->GetPropComponent(PropId));
+			}
+		}
+	}
+
+	for (const FGunSnapshot& Snapshot : DroppedGuns)
+	{
+		if (Snapshot.Body.Holder != INDEX_NONE && Snapshot.Gun.IsValid() && Snapshot.Gun->GetGunState() == EGunState::Dropped)
+		{
+			RestoreHold(Snapshot.Body.Holder, Cast<UPrimitiveComponent>(Snapshot.Gun->GetRootComponent()));
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_PropSnapshotRestoredBodies, NumRestored);
+
+	return NumRestored;
+}
+
+void UPropSnapshotSubsystem::RestoreHold(int32 Holder, UPrimitiveComponent* Component)
+{
+	AGravityGun* Gun = Holders.IsValidIndex(Holder) ? Holders[Holder].Get() : nullptr;
+	if (!Gun || !Component) return;
+
+	// Guns put away or lying on the ground since the capture don't grab anything.
+	const EGunState State = Gun->GetGunState();
+	if (State == EGunState::Holstered || State == EGunState::Dropped) return;
+
+	if (Gun->GetHeldComponent() != Component)
+	{
+		Gun->ReleaseGrabbedObject();
+		Gun->HoldComponent(Component);
+	}
+}
+
+bool UPropSnapshotSubsystem::SaveSnapshot(const FString& Filename)
+{
+	if (!bHasSnapshot) return false;
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	SerializeSnapshot(Writer);
+
+	return FFileHelper::SaveArrayToFile(Data, *Filename);
+}
+
+bool UPropSnapshotSubsystem::LoadSnapshot(const FString& Filename)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Filename)) return false;
+
+	FMemoryReader Reader(Data);
+	SerializeSnapshot(Reader);
+
+	bHasSnapshot = !Reader.IsError();
+	if (!bHasSnapshot)
+	{
+		Managers.Reset();
+		DroppedGuns.Reset();
+		Holders.Reset();
+	}
+
+	return bHasSnapshot;
+}
+
+void UPropSnapshotSubsystem::SerializeSnapshot(FArchive& Ar)
+{
+	UWorld* World = GetWorld();
+
+	uint32 Magic = SNAPSHOT_MAGIC;
+	uint32 Version = SNAPSHOT_VERSION;
+	Ar << Magic;
+	Ar << Version;
+
+	if (Magic != SNAPSHOT_MAGIC || Version != SNAPSHOT_VERSION)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	int32 NumHolders = Holders.Num();
+	Ar << NumHolders;
+	if (!IsPlausibleCount(Ar, NumHolders))
+	{
+		Ar.SetError();
+		return;
+	}
+	Holders.SetNum(NumHolders);
+	for (TWeakObjectPtr<AGravityGun>& Holder : Holders)
+	{
+		SerializeActorName(Ar, Holder, World);
+	}
+
+	int32 NumManagers = Managers.Num();
+	Ar << NumManagers;
+	if (!IsPlausibleCount(Ar, NumManagers))
+	{
+		Ar.SetError();
+		return;
+	}
+	Managers.SetNum(NumManagers);
+	for (FManagerSnapshot& Snapshot : Managers)
+	{
+		SerializeActorName(Ar, Snapshot.Manager, World);
+		Ar << Snapshot.Props;
+	}
+
+	int32 NumDroppedGuns = DroppedGuns.Num();
+	Ar << NumDroppedGuns;
+	if (!IsPlausibleCount(Ar, NumDroppedGuns))
+	{
+		Ar.SetError();
+		return;
+	}
+	DroppedGuns.SetNum(NumDroppedGuns);
+	for (FGunSnapshot& Snapshot : DroppedGuns)
+	{
+		SerializeActorName(Ar, Snapshot.Gun, World);
+		Ar << Snapshot.Body;
+	}
+}
@@ -0,0 +1,94 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Props/BodySnapshot.h"
+#include "Stats/Stats.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PropSnapshotSubsystem.generated.h"
+
+class AGravityGun;
+class AGrabbablePropManager;
+class AGun;
+
+DECLARE_STATS_GROUP(TEXT("PropSnapshot"), STATGROUP_PropSnapshot, STATCAT_Advanced);
+
+/**
+ * Captures every grabbable prop and dropped gun and restores them in place, to reset a round without reloading the map.
+ * A snapshot holds the transform, velocities and sleep state of every body and which gravity gun holds it,
+ * and can be saved to a compact binary file to start benchmarks from a known state.
+ * Restoring is done by the server or a standalone game, clients follow through replication.
+ */
+UCLASS()
+class ARBETSPROV_API UPropSnapshotSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Captures the current state, replacing the previous snapshot. */
+	UFUNCTION(BlueprintCallable, Category = "Snapshot")
+	void CaptureSnapshot();
+
+	/**
+	 * Moves every captured body back to its captured state and makes the captured holders hold them again.
+	 * Awake or held props that can't get a simulating component are left in place, with a warning.
+	 * @param bDeltaOnly - Whether to only rewrite bodies that moved since the capture.
+	 * @return The amount of bodies that were rewritten.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Snapshot")
+	int32 RestoreSnapshot(bool bDeltaOnly);
+
+	/**
+	 * Saves the snapshot to a file, actors are referred to by name.
+	 * @param Filename - The file to write.
+	 * @return Whether or not the file was written.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Snapshot")
+	bool SaveSnapshot(const FString& Filename);
+
+	/**
+	 * Loads a snapshot saved in the same map, replacing the current snapshot. Restore it with RestoreSnapshot.
+	 * @param Filename - The file to read.
+	 * @return Whether or not the file was a snapshot.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Snapshot")
+	bool LoadSnapshot(const FString& Filename);
+
+	/** Returns whether or not there is a snapshot to restore. */
+	FORCEINLINE bool HasSnapshot() const { return bHasSnapshot; }
+
+private:
+	/** Writes or reads the snapshot. */
+	void SerializeSnapshot(FArchive& Ar);
+
+	/**
+	 * Makes a captured holder hold a component again, unless the holder has been holstered or dropped since.
+	 * @param Holder - Index of the holder in Holders.
+	 * @param Component - The component to hold.
+	 */
+	void RestoreHold(int32 Holder, UPrimitiveComponent* Component);
+
+	struct FManagerSnapshot
+	{
+		TWeakObjectPtr<AGrabbablePropManager> Manager;
+		/** States indexed by prop id. */
+		TArray<FBodySnapshot> Props;
+	};
+
+	struct FGunSnapshot
+	{
+		TWeakObjectPtr<AGun> Gun;
+		FBodySnapshot Body;
+	};
+
+	TArray<FManagerSnapshot> Managers;
+	TArray<FGunSnapshot> DroppedGuns;
+
+	/** Gravity guns holding a body, referred to by FBodySnapshot::Holder. */
+	TArray<TWeakObjectPtr<AGravityGun>> Holders;
+
+	bool bHasSnapshot = false;
+};
@@ -0,0 +1,94 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Telemetry file layout: an FTelemetryFileHeader followed by NumBlocks fixed size FTelemetryBlock slots used as a ring.
+ * A block stores its frames column by column, so a reader interested in one counter reads one contiguous array.
+ * Blocks are written as raw little endian memory, the file is meant to be read on the same kind of machine.
+ */
+struct FTelemetryFileHeader
+{
+	static constexpr uint32 MAGIC = 0x4D4C5441; // "ATLM"
+	static constexpr uint32 VERSION = 1;
+
+	uint32 Magic = MAGIC;
+	uint32 Version = VERSION;
+	uint32 FramesPerBlock = 0;
+	uint32 NumBlocks = 0;
+};
+
+/** A block of consecutive frames. */
+struct FTelemetryBlock
+{
+	static constexpr int32 FRAMES_PER_BLOCK = 256;
+
+	/** Increasing number of the block within the recording, 0 for a slot that was never written. */
+	uint64 Sequence = 0;
+	/** GFrameCounter of the first frame. */
+	uint64 FirstFrame = 0;
+	/** Amount of valid frames, only the last block of a recording may be partial. */
+	uint32 NumFrames = 0;
+	uint32 Padding = 0;
+
+	float FrameTimeMs[FRAMES_PER_BLOCK];
+	float GameThreadMs[FRAMES_PER_BLOCK];
+	uint16 ActiveGravityGuns[FRAMES_PER_BLOCK];
+	uint16 Grabs[FRAMES_PER_BLOCK];
+	uint16 Pushes[FRAMES_PER_BLOCK];
+	uint16 ProjectilesAlive[FRAMES_PER_BLOCK];
+	uint32 Traces[FRAMES_PER_BLOCK];
+};
+
+/** Reads telemetry files written by UTelemetrySubsystem. */
+struct FTelemetryFile
+{
+	/**
+	 * Finds the written blocks of a telemetry file in recording order.
+	 * @param Data - The contents of the file.
+	 * @param OutBlocks - Upon return will contain the written blocks, pointing into Data.
+	 * @return Whether or not Data is a telemetry file of this version.
+	 */
+	static bool GetBlocks(const TArray<uint8>& Data, TArray<const FTelemetryBlock*>& OutBlocks)
+	{
+		OutBlocks.Reset();
+		if (Data.Num() < int32(sizeof(FTelemetryFileHeader))) return false;
+
+		const FTelemetryFileHeader* Header = reinterpret_cast<const FTelemetryFileHeader*>(Data.GetData());
+		if (Header->Magic != FTelemetryFileHeader::MAGIC || Header->Version != FTelemetryFileHeader::VERSION || Header->FramesPerBlock != FTelemetryBlock::FRAMES_PER_BLOCK)
+		{
+			return false;
+		}
+
+		// The file may end before the last slot if the ring never wrapped.
+		const int64 AvailableBlocks = (Data.Num() - int64(sizeof(FTelemetryFileHeader))) / int64(sizeof(FTelemetryBlock));
+		const int64 NumBlocks = FMath::Min<int64>(Header->NumBlocks, AvailableBlocks);
+		for (int64 i = 0; i < NumBlocks; ++i)
+		{
+			const FTelemetryBlock* Block = reinterpret_cast<const FTelemetryBlock*>(Data.GetData() + sizeof(FTelemetryFileHeader) + i * sizeof(FTelemetryBlock));
+			if (Block->Sequence != 0 && Block->NumFrames <= uint32(FTelemetryBlock::FRAMES_PER_BLOCK))
+			{
+				OutBlocks.Add(Block);
+			}
+		}
+
+		OutBlocks.Sort([](const FTelemetryBlock& A, const FTelemetryBlock& B)
+		{
+			return A.Sequence < B.Sequence;
+		});
+
+		return true;
+	}
+
+	/**
+	 * Gets the offset of a block slot in the file.
+	 * @param Slot - Index of the slot in the ring.
+	 * @return The offset in bytes.
+	 */
+	static constexpr int64 GetBlockOffset(int32 Slot)
+	{
+		return int64(sizeof(FTelemetryFileHeader)) + int64(Slot) * int64(sizeof(FTelemetryBlock));
+	}
+};
@@ -0,0 +1,120 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+
+#include "TelemetrySubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+
+DECLARE_CYCLE_STAT(TEXT("Record Frame"), STAT_TelemetryRecord, STATGROUP_Telemetry);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dropped Frames"), STAT_TelemetryDroppedFrames, STATGROUP_Telemetry);
+
+static TAutoConsoleVariable<int32> CVarTelemetry(
+	TEXT("arbetsprov.Telemetry"),
+	0,
+	TEXT("Records frame times and gameplay counters to Saved/Telemetry, read when a game world starts.\n")
+	TEXT("0: Off, 1: On"));
+
+void UTelemetrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const UWorld* World = GetWorld();
+	const bool bEnabled = CVarTelemetry.GetValueOnGameThread() != 0 || FParse::Param(FCommandLine::Get(), TEXT("Telemetry"));
+	if (!bEnabled || !World || !World->IsGameWorld()) return;
+
+	const FString Filename = FPaths::ProjectSavedDir() / TEXT("Telemetry") / FString::Printf(TEXT("%s_%s.telemetry"), *World->GetMapName(), *FDateTime::Now().ToString());
+	Writer = MakeUnique<FTelemetryWriter>(Filename, NUM_BLOCKS);
+}
+
+void UTelemetrySubsystem::Deinitialize()
+{
+	if (Writer)
+	{
+		SubmitCurrentBlock();
+
+		// Waits for the last blocks to be written.
+		Writer.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+bool UTelemetrySubsystem::IsTickable() const
+{
+	return !HasAnyFlags(RF_ClassDefaultObject) && Writer.IsValid();
+}
+
+TStatId UTelemetrySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTelemetrySubsystem, STATGROUP_Telemetry);
+}
+
+void UTelemetrySubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TelemetryRecord);
+
+	if (!CurrentBlock)
+	{
+		CurrentBlock = Writer->AcquireBlock();
+		if (CurrentBlock)
+		{
+			CurrentBlock->FirstFrame = GFrameCounter;
+			CurrentBlock->NumFrames = 0;
+		}
+	}
+
+	if (CurrentBlock)
+	{
+		// Runs after every actor has ticked, so the counters cover the whole frame.
+		const int32 Frame = CurrentBlock->NumFrames++;
+		CurrentBlock->FrameTimeMs[Frame] = FApp::GetDeltaTime() * 1000.f;
+		CurrentBlock->GameThreadMs[Frame] = FPlatformTime::ToMilliseconds(GGameThreadTime);
+		CurrentBlock->ActiveGravityGuns[Frame] = uint16(FMath::Min(Counters[(int32)ETelemetryCounter::ActiveGravityGuns], (int32)MAX_uint16));
+		CurrentBlock->Grabs[Frame] = uint16(FMath::Min(Counters[(int32)ETelemetryCounter::Grabs], (int32)MAX_uint16));
+		CurrentBlock->Pushes[Frame] = uint16(FMath::Min(Counters[(int32)ETelemetryCounter::Pushes], (int32)MAX_uint16));
+		CurrentBlock->ProjectilesAlive[Frame] = uint16(FMath::Clamp(Counters[(int32)ETelemetryCounter::ProjectilesAlive], 0, (int32)MAX_uint16));
+		CurrentBlock->Traces[Frame] = uint32(FMath::Max(Counters[(int32)ETelemetryCounter::Traces], 0));
+
+		if (CurrentBlock->NumFrames == FTelemetryBlock::FRAMES_PER_BLOCK)
+		{
+			SubmitCurrentBlock();
+		}
+	}
+	else
+	{
+		// The writer is behind, drop the frame rather than wait for it.
+		INC_DWORD_STAT(STAT_TelemetryDroppedFrames);
+	}
+
+	for (int32 i = 0; i < (int32)ETelemetryCounter::Count; ++i)
+	{
+		if (i != (int32)ETelemetryCounter::ProjectilesAlive)
+		{
+			Counters[i] = 0;
+		}
+	}
+}
+
+void UTelemetrySubsystem::Count(const UObject* WorldContextObject, ETelemetryCounter Counter, int32 Amount)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UTelemetrySubsystem* Telemetry = World ? World->GetSubsystem<UTelemetrySubsystem>() : nullptr;
+	if (Telemetry && Telemetry->IsRecording())
+	{
+		Telemetry->Counters[(int32)Counter] += Amount;
+	}
+}
+
+void UTelemetrySubsystem::SubmitCurrentBlock()
+{
+	if (CurrentBlock && CurrentBlock->NumFrames > 0)
+	{
+		Writer->SubmitBlock(CurrentBlock);
+		CurrentBlock = nullptr;
+	}
+}
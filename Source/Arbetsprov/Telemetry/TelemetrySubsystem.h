@@ -0,0 +1,74 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Telemetry/TelemetryWriter.h"
+#include "Tickable.h"
+#include "TelemetrySubsystem.generated.h"
+
+DECLARE_STATS_GROUP(TEXT("Telemetry"), STATGROUP_Telemetry, STATCAT_Advanced);
+
+/** Gameplay counters recorded with every frame. */
+enum class ETelemetryCounter : uint8
+{
+	/** Gravity guns that ticked this frame. */
+	ActiveGravityGuns,
+	Grabs,
+	Pushes,
+	/** Traces and overlaps issued by weapons this frame. */
+	Traces,
+	/** Projectiles in the world, not reset between frames. */
+	ProjectilesAlive,
+	Count
+};
+
+/**
+ * Records frame times and gameplay counters of every frame to a ring file in Saved/Telemetry,
+ * enabled with arbetsprov.Telemetry 1 or -Telemetry on the command line.
+ * Recording a frame writes a handful of values into a block in memory, full blocks are written by FTelemetryWriter on its own thread.
+ * Convert a recording with the TelemetryToCsv commandlet.
+ */
+UCLASS()
+class ARBETSPROV_API UTelemetrySubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	/**
+	 * Adds to a counter of the current frame if telemetry is recording in the world of an object.
+	 * @param WorldContextObject - An object in the world to record in.
+	 * @param Counter - The counter to add to.
+	 * @param Amount - The amount to add, negative to remove.
+	 */
+	static void Count(const UObject* WorldContextObject, ETelemetryCounter Counter, int32 Amount = 1);
+
+	/** Returns whether or not frames are being recorded. */
+	FORCEINLINE bool IsRecording() const { return Writer.IsValid(); }
+
+	/** Amount of block slots in the ring file, about 70 minutes at 60 frames per second. */
+	static constexpr int32 NUM_BLOCKS = 1024;
+
+private:
+	/** Hands the current block, full or not, over to the writer. */
+	void SubmitCurrentBlock();
+
+	TUniquePtr<FTelemetryWriter> Writer;
+
+	/** The block frames are recorded to, nullptr until one is free. */
+	FTelemetryBlock* CurrentBlock = nullptr;
+
+	int32 Counters[(int32)ETelemetryCounter::Count] = {};
+};
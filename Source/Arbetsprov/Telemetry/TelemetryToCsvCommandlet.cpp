@@ -0,0 +1,79 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+
+#include "TelemetryToCsvCommandlet.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Telemetry/TelemetryFormat.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTelemetryToCsv, Log, All);
+
+UTelemetryToCsvCommandlet::UTelemetryToCsvCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UTelemetryToCsvCommandlet::Main(const FString& Params)
+{
+	FString InFilename;
+	if (!FParse::Value(*Params, TEXT("In="), InFilename))
+	{
+		UE_LOG(LogTelemetryToCsv, Error, TEXT("Usage: -run=TelemetryToCsv -In=<recording> [-Out=<csv>]"));
+		return 1;
+	}
+
+	FString OutFilename;
+	if (!FParse::Value(*Params, TEXT("Out="), OutFilename))
+	{
+		OutFilename = FPaths::ChangeExtension(InFilename, TEXT("csv"));
+	}
+
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *InFilename))
+	{
+		UE_LOG(LogTelemetryToCsv, Error, TEXT("Could not read %s."), *InFilename);
+		return 1;
+	}
+
+	TArray<const FTelemetryBlock*> Blocks;
+	if (!FTelemetryFile::GetBlocks(Data, Blocks))
+	{
+		UE_LOG(LogTelemetryToCsv, Error, TEXT("%s is not a telemetry recording of version %u."), *InFilename, FTelemetryFileHeader::VERSION);
+		return 1;
+	}
+
+	FString Csv = TEXT("Frame,FrameTimeMs,GameThreadMs,ActiveGravityGuns,Grabs,Pushes,ProjectilesAlive,Traces\n");
+	Csv.Reserve(Blocks.Num() * FTelemetryBlock::FRAMES_PER_BLOCK * 48);
+
+	int32 NumFrames = 0;
+	for (const FTelemetryBlock* Block : Blocks)
+	{
+		for (uint32 i = 0; i < Block->NumFrames; ++i)
+		{
+			Csv += FString::Printf(TEXT("%llu,%.3f,%.3f,%u,%u,%u,%u,%u\n"),
+				Block->FirstFrame + i,
+				Block->FrameTimeMs[i],
+				Block->GameThreadMs[i],
+				Block->ActiveGravityGuns[i],
+				Block->Grabs[i],
+				Block->Pushes[i],
+				Block->ProjectilesAlive[i],
+				Block->Traces[i]);
+		}
+
+		NumFrames += Block->NumFrames;
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *OutFilename))
+	{
+		UE_LOG(LogTelemetryToCsv, Error, TEXT("Could not write %s."), *OutFilename);
+		return 1;
+	}
+
+	UE_LOG(LogTelemetryToCsv, Display, TEXT("Wrote %d frames from %d blocks to %s."), NumFrames, Blocks.Num(), *OutFilename);
+
+	return 0;
+}
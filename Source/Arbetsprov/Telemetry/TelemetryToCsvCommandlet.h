@@ -0,0 +1,22 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TelemetryToCsvCommandlet.generated.h"
+
+/**
+ * Converts a telemetry recording to CSV with one row per frame.
+ * Usage: UE4Editor-Cmd Arbetsprov -run=TelemetryToCsv -In=<recording> [-Out=<csv>]
+ */
+UCLASS()
+class UTelemetryToCsvCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTelemetryToCsvCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,112 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+
+#include "TelemetryWriter.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTelemetry, Log, All);
+
+FTelemetryWriter::FTelemetryWriter(const FString& InFilename, int32 InNumBlocks)
+	: Filename(InFilename)
+	, NumBlocks(FMath::Max(InNumBlocks, 1))
+{
+	for (int32 i = 0; i < NUM_BUFFERS; ++i)
+	{
+		FTelemetryBlock* Block = Buffers.Add_GetRef(MakeUnique<FTelemetryBlock>()).Get();
+		FreeBlocks.Enqueue(Block);
+	}
+
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("TelemetryWriter"), 0, TPri_BelowNormal);
+}
+
+FTelemetryWriter::~FTelemetryWriter()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	WorkEvent = nullptr;
+}
+
+FTelemetryBlock* FTelemetryWriter::AcquireBlock()
+{
+	FTelemetryBlock* Block = nullptr;
+	FreeBlocks.Dequeue(Block);
+
+	return Block;
+}
+
+void FTelemetryWriter::SubmitBlock(FTelemetryBlock* Block)
+{
+	Block->Sequence = NextSequence++;
+	SubmittedBlocks.Enqueue(Block);
+	WorkEvent->Trigger();
+}
+
+uint32 FTelemetryWriter::Run()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+	File.Reset(PlatformFile.OpenWrite(*Filename));
+
+	if (File)
+	{
+		FTelemetryFileHeader Header;
+		Header.FramesPerBlock = FTelemetryBlock::FRAMES_PER_BLOCK;
+		Header.NumBlocks = NumBlocks;
+		File->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	}
+	else
+	{
+		UE_LOG(LogTelemetry, Warning, TEXT("Could not open %s, telemetry is discarded."), *Filename);
+	}
+
+	while (!bStopping)
+	{
+		WorkEvent->Wait(100);
+		WriteSubmittedBlocks();
+	}
+
+	// Blocks submitted right before stopping.
+	WriteSubmittedBlocks();
+
+	if (File)
+	{
+		File->Flush();
+		File.Reset();
+	}
+
+	return 0;
+}
+
+void FTelemetryWriter::Stop()
+{
+	bStopping = true;
+	WorkEvent->Trigger();
+}
+
+void FTelemetryWriter::WriteSubmittedBlocks()
+{
+	FTelemetryBlock* Block = nullptr;
+	while (SubmittedBlocks.Dequeue(Block))
+	{
+		if (File)
+		{
+			const int32 Slot = int32((Block->Sequence - 1) % NumBlocks);
+			File->Seek(FTelemetryFile::GetBlockOffset(Slot));
+			File->Write(reinterpret_cast<const uint8*>(Block), sizeof(FTelemetryBlock));
+		}
+
+		FreeBlocks.Enqueue(Block);
+	}
+}
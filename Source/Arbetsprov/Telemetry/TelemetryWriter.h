@@ -0,0 +1,71 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+#include "Telemetry/TelemetryFormat.h"
+
+class FEvent;
+class FRunnableThread;
+class IFileHandle;
+
+/**
+ * Writes telemetry blocks to a ring file on its own thread.
+ * The game thread fills blocks from a small fixed pool and hands them over without waiting,
+ * the writer thread does all file I/O, including opening the file, and gives the blocks back.
+ */
+class FTelemetryWriter : public FRunnable
+{
+public:
+	/**
+	 * Starts the writer thread.
+	 * @param InFilename - The file to write, replaced if it exists.
+	 * @param InNumBlocks - Amount of block slots in the ring file.
+	 */
+	FTelemetryWriter(const FString& InFilename, int32 InNumBlocks);
+
+	/** Writes the blocks handed over so far and stops the writer thread. */
+	virtual ~FTelemetryWriter();
+
+	/**
+	 * Gets an empty block to fill. Game thread only.
+	 * @return The block, or nullptr if every block is still waiting to be written.
+	 */
+	FTelemetryBlock* AcquireBlock();
+
+	/**
+	 * Hands a filled block over to be written. Game thread only.
+	 * @param Block - A block from AcquireBlock.
+	 */
+	void SubmitBlock(FTelemetryBlock* Block);
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End of FRunnable interface
+
+	/** Amount of blocks the game thread can fill while others are being written. */
+	static constexpr int32 NUM_BUFFERS = 4;
+
+private:
+	/** Writes every submitted block. Writer thread only. */
+	void WriteSubmittedBlocks();
+
+	const FString Filename;
+	const int32 NumBlocks;
+
+	TArray<TUniquePtr<FTelemetryBlock>> Buffers;
+	TQueue<FTelemetryBlock*, EQueueMode::Spsc> SubmittedBlocks;
+	TQueue<FTelemetryBlock*, EQueueMode::Spsc> FreeBlocks;
+
+	/** Sequence of the next submitted block. Game thread only. */
+	uint64 NextSequence = 1;
+
+	TUniquePtr<IFileHandle> File;
+
+	FEvent* WorkEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+	TAtomic<bool> bStopping{ false };
+};
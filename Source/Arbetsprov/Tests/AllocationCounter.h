@@ -0,0 +1,76 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CoreGlobals.h"
+#include "HAL/MemoryBase.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Counts heap allocations made on the game thread while in scope, by putting itself in front of GMalloc.
+ * Only meant for automation tests, other threads keep allocating through it uncounted.
+ */
+class FScopedAllocationCounter final : public FMalloc
+{
+public:
+	FScopedAllocationCounter()
+		: Inner(GMalloc)
+	{
+		GMalloc = this;
+	}
+
+	virtual ~FScopedAllocationCounter()
+	{
+		GMalloc = Inner;
+	}
+
+	/** Returns the amount of allocations and reallocations made on the game thread so far. */
+	FORCEINLINE int32 GetCount() const { return Count; }
+
+	/** Starts counting from zero again. */
+	FORCEINLINE void Reset() { Count = 0; }
+
+	virtual void* Malloc(SIZE_T Size, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Malloc(Size, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Size, uint32 Alignment) override
+	{
+		// Reallocating to zero is a free.
+		if (Size > 0)
+		{
+			CountAllocation();
+		}
+		return Inner->Realloc(Original, Size, Alignment);
+	}
+
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Size, uint32 Alignment) override { return Inner->QuantizeSize(Size, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+	virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+private:
+	void CountAllocation()
+	{
+		if (IsInGameThread())
+		{
+			++Count;
+		}
+	}
+
+	FMalloc* Inner;
+	int32 Count = 0;
+};
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,76 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Components/StaticMeshComponent.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/TestWorld.h"
+#include "Weapons/PhysicsForceBatch.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Compares adding forces body by body against one force batch, on as many bodies as a tractor beam in a full room pulls.
+ * Reports both times, it only fails if bodies can't be queued since timings vary between machines.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPhysicsForceBatchBenchmark, "Arbetsprov.Weapons.PhysicsForceBatch.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FPhysicsForceBatchBenchmark::RunTest(const FString& Parameters)
+{
+	static constexpr int32 NUM_BODIES = 256;
+	static constexpr int32 NUM_ITERATIONS = 200;
+	static constexpr int32 GRID_SIZE = 16;
+	static constexpr float SPACING = 200.f;
+
+	FTestWorld World;
+
+	TArray<UPrimitiveComponent*> Bodies;
+	for (int32 i = 0; i < NUM_BODIES; ++i)
+	{
+		UStaticMeshComponent* Cube = World.SpawnCube(FVector((i % GRID_SIZE) * SPACING, (i / GRID_SIZE) * SPACING, 0.f));
+		if (!Cube)
+		{
+			AddWarning(TEXT("The engine cube couldn't be loaded, skipping."));
+			return true;
+		}
+		Bodies.Add(Cube);
+	}
+
+	World.Tick();
+
+	const FVector Acceleration(0.f, 0.f, 100.f);
+
+	const double PerBodyStart = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NUM_ITERATIONS; ++Iteration)
+	{
+		for (UPrimitiveComponent* Body : Bodies)
+		{
+			Body->AddForce(Acceleration, NAME_None, true);
+		}
+	}
+	const double PerBodySeconds = FPlatformTime::Seconds() - PerBodyStart;
+
+	FPhysicsForceBatch Batch;
+	int32 NumQueued = 0;
+
+	const double BatchStart = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NUM_ITERATIONS; ++Iteration)
+	{
+		for (UPrimitiveComponent* Body : Bodies)
+		{
+			Batch.Add(Body, Acceleration);
+		}
+		NumQueued = Batch.Num();
+		Batch.Apply(World.Get(), true);
+	}
+	const double BatchSeconds = FPlatformTime::Seconds() - BatchStart;
+
+	TestEqual(TEXT("Every body is queued"), NumQueued, NUM_BODIES);
+
+	AddInfo(FString::Printf(TEXT("%d bodies. Per body: %.2f us per frame, batch: %.2f us per frame, %.2fx."), NUM_BODIES,
+		PerBodySeconds * 1.e6 / NUM_ITERATIONS, BatchSeconds * 1.e6 / NUM_ITERATIONS, PerBodySeconds / FMath::Max(BatchSeconds, 1.e-9)));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
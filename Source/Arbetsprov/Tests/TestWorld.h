@@ -0,0 +1,73 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** A game world that has begun play, for automation tests. Destroyed with the helper. */
+class FTestWorld
+{
+public:
+	FTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false);
+		FWorldContext& Context = GEngine->CreateNewWorldContext(EWorldType::Game);
+		Context.SetCurrentWorld(World);
+
+		World->InitializeActorsForPlay(FURL());
+		// There is no game mode to start play, begin it directly.
+		World->GetWorldSettings()->NotifyBeginPlay();
+	}
+
+	~FTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	FORCEINLINE UWorld* operator->() const { return World; }
+	FORCEINLINE UWorld* Get() const { return World; }
+
+	/**
+	 * Advances one frame, including GFrameCounter like the engine loop does.
+	 * @param DeltaSeconds - Length of the frame.
+	 */
+	void Tick(float DeltaSeconds = 1.f / 60.f)
+	{
+		++GFrameCounter;
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+	}
+
+	/**
+	 * Spawns a simulating engine cube.
+	 * @param Location - Where to spawn it.
+	 * @return The cube's component, nullptr if the engine content isn't available.
+	 */
+	UStaticMeshComponent* SpawnCube(const FVector& Location)
+	{
+		UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+		AStaticMeshActor* Actor = Cube ? World->SpawnActor<AStaticMeshActor>(Location, FRotator::ZeroRotator) : nullptr;
+		if (!Actor) return nullptr;
+
+		UStaticMeshComponent* Component = Actor->GetStaticMeshComponent();
+		Actor->SetMobility(EComponentMobility::Movable);
+		Component->SetStaticMesh(Cube);
+		Component->SetCollisionProfileName(UCollisionProfile::PhysicsActor_ProfileName);
+		Component->SetSimulatePhysics(true);
+		Component->SetEnableGravity(false);
+
+		return Component;
+	}
+
+private:
+	UWorld* World = nullptr;
+};
+
+#endif // WITH_DEV_AUTOMATION_TESTS
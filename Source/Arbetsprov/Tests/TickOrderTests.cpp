@@ -0,0 +1,78 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "ArbetsprovCharacter.h"
+#include "Camera/CameraComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/AutomationTest.h"
+#include "PhysicsEngine/PhysicsHandleComponent.h"
+#include "Tests/TestWorld.h"
+#include "Weapons/GravityGun.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Moves and turns a character holding a body with a gravity gun, then checks after one frame that the physics handle
+ * targets this frame's view and that the gun state the HUD reads was published in this frame.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGravityGunTickLatencyTest, "Arbetsprov.Weapons.GravityGun.ZeroFrameLatency", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FGravityGunTickLatencyTest::RunTest(const FString& Parameters)
+{
+	static constexpr float DELTA_SECONDS = 1.f / 60.f;
+	static constexpr float TOLERANCE = 0.5f;
+
+	FTestWorld World;
+
+	AArbetsprovCharacter* Character = World->SpawnActor<AArbetsprovCharacter>(FVector(0.f, 0.f, 200.f), FRotator::ZeroRotator);
+	APlayerController* Controller = World->SpawnActor<APlayerController>();
+	AGravityGun* Gun = World->SpawnActor<AGravityGun>(FVector::ZeroVector, FRotator::ZeroRotator);
+	if (!TestNotNull(TEXT("Character"), Character) || !TestNotNull(TEXT("Controller"), Controller) || !TestNotNull(TEXT("Gravity gun"), Gun)) return false;
+
+	Controller->Possess(Character);
+	Gun->PickUp(Character);
+
+	UStaticMeshComponent* Cube = World.SpawnCube(Character->GetActorLocation() + FVector(300.f, 0.f, 0.f));
+	if (!Cube)
+	{
+		AddWarning(TEXT("The engine cube couldn't be loaded, skipping."));
+		return true;
+	}
+
+	if (!TestTrue(TEXT("Holding the cube"), Gun->HoldComponent(Cube))) return false;
+
+	World.Tick(DELTA_SECONDS);
+
+	// The turn is applied before the frame like look input, the movement happens during the frame.
+	UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	Movement->GravityScale = 0.f;
+	Movement->SetMovementMode(MOVE_Flying);
+	Movement->Velocity = FVector(0.f, 1200.f, 0.f);
+	Controller->SetControlRotation(FRotator(10.f, 45.f, 0.f));
+
+	const FVector LocationBefore = Character->GetFP_Camera()->GetComponentLocation();
+	World.Tick(DELTA_SECONDS);
+
+	const FVector CameraLocation = Character->GetFP_Camera()->GetComponentLocation();
+	const FVector CameraDirection = Controller->GetControlRotation().Vector();
+	TestTrue(TEXT("The character moved during the frame"), !CameraLocation.Equals(LocationBefore, TOLERANCE));
+
+	UPhysicsHandleComponent* PhysicsHandle = Gun->FindComponentByClass<UPhysicsHandleComponent>();
+	FVector TargetLocation;
+	FRotator TargetRotation;
+	PhysicsHandle->GetTargetLocationAndRotation(TargetLocation, TargetRotation);
+
+	// The target is somewhere along this frame's view, how far depends on the gun's offsets and the body's size.
+	const FVector ToTarget = TargetLocation - CameraLocation;
+	TestTrue(TEXT("The handle target is in front of this frame's camera"), FVector::DotProduct(ToTarget, CameraDirection) > 0.f);
+	TestTrue(TEXT("The handle target is on this frame's view"), FVector::CrossProduct(ToTarget, CameraDirection).Size() < TOLERANCE);
+
+	const FGunStateSnapshot Snapshot = Gun->GetStateSnapshot();
+	TestEqual(TEXT("The gun state was published this frame"), int64(Snapshot.FrameNumber), int64(GFrameCounter));
+	TestTrue(TEXT("The published state knows about the held body"), Snapshot.HeldObjectDistance >= 0.f);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
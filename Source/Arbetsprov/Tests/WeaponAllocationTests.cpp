@@ -0,0 +1,90 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AllocationCounter.h"
+#include "Tests/TestWorld.h"
+#include "Weapons/GravityGun.h"
+#include "Weapons/WeaponFrameScratch.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWeaponFrameScratchTest, "Arbetsprov.Weapons.FrameScratch.ReusesCapacity", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWeaponFrameScratchTest::RunTest(const FString& Parameters)
+{
+	static constexpr int32 NUM_RESULTS = 32;
+
+	FWeaponFrameScratch Scratch;
+
+	++GFrameCounter;
+	Scratch.BeginFrame();
+	Scratch.Overlaps.SetNum(NUM_RESULTS);
+
+	Scratch.BeginFrame();
+	TestEqual(TEXT("Results are kept within a frame"), Scratch.Overlaps.Num(), NUM_RESULTS);
+
+	++GFrameCounter;
+	int32 Allocations = 0;
+	{
+		FScopedAllocationCounter Counter;
+		Scratch.BeginFrame();
+		TestEqual(TEXT("Results are cleared on a new frame"), Scratch.Overlaps.Num(), 0);
+
+		Scratch.Overlaps.SetNum(NUM_RESULTS);
+		Allocations = Counter.GetCount();
+	}
+	TestEqual(TEXT("Refilling the results of a new frame doesn't allocate"), Allocations, 0);
+
+	return true;
+}
+
+/** Ticks a gravity gun aimed at simulating bodies with the tractor beam on, and counts the heap allocations of its ticks. */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGravityGunTickAllocationTest, "Arbetsprov.Weapons.GravityGun.TickDoesNotAllocate", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FGravityGunTickAllocationTest::RunTest(const FString& Parameters)
+{
+	static constexpr int32 NUM_WARM_UP_FRAMES = 10;
+	static constexpr int32 NUM_MEASURED_FRAMES = 60;
+	static constexpr float DELTA_SECONDS = 1.f / 60.f;
+
+	FTestWorld World;
+
+	AGravityGun* Gun = World->SpawnActor<AGravityGun>(FVector::ZeroVector, FRotator::ZeroRotator);
+	if (!TestNotNull(TEXT("Gravity gun"), Gun)) return false;
+
+	// Along the muzzle so the targeting trace and the tractor beam have bodies to work on.
+	for (const float Distance : { 400.f, 800.f, 1200.f })
+	{
+		if (!World.SpawnCube(FVector(Distance, 0.f, 0.f)))
+		{
+			AddWarning(TEXT("The engine cube couldn't be loaded, measuring without bodies."));
+			break;
+		}
+	}
+
+	Gun->StartContinuousAction();
+
+	// The first frames fill the gun's scratch and the force batch up to their steady state size.
+	for (int32 Frame = 0; Frame < NUM_WARM_UP_FRAMES; ++Frame)
+	{
+		World.Tick(DELTA_SECONDS);
+	}
+
+	int32 Allocations = 0;
+	for (int32 Frame = 0; Frame < NUM_MEASURED_FRAMES; ++Frame)
+	{
+		World.Tick(DELTA_SECONDS);
+
+		// Only the gun's own tick is counted, the world tick allocates for its task graph.
+		FScopedAllocationCounter Counter;
+		Gun->Tick(DELTA_SECONDS);
+		Allocations += Counter.GetCount();
+	}
+
+	TestEqual(TEXT("Heap allocations in gravity gun ticks once warmed up"), Allocations, 0);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,151 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Weapons/WeaponMath.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWeaponMathReachAlphaTest, "Arbetsprov.Weapons.WeaponMath.ReachAlpha", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWeaponMathReachAlphaTest::RunTest(const FString& Parameters)
+{
+	TestEqual(TEXT("Full effect at the weapon"), FWeaponMath::ReachAlpha(0.f, 100.f), 1.f);
+	TestEqual(TEXT("Full effect behind the weapon"), FWeaponMath::ReachAlpha(-10.f, 100.f), 1.f);
+	TestEqual(TEXT("Half effect halfway"), FWeaponMath::ReachAlpha(25.f, 50.f), 0.5f);
+	TestEqual(TEXT("No effect at the reach"), FWeaponMath::ReachAlpha(100.f, 100.f), 0.f);
+	TestEqual(TEXT("No effect beyond the reach"), FWeaponMath::ReachAlpha(150.f, 100.f), 0.f);
+	TestEqual(TEXT("No effect with zero reach"), FWeaponMath::ReachAlpha(0.f, 0.f), 0.f);
+	TestEqual(TEXT("No effect with negative reach"), FWeaponMath::ReachAlpha(0.f, -100.f), 0.f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWeaponMathFalloffTest, "Arbetsprov.Weapons.WeaponMath.Falloff", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWeaponMathFalloffTest::RunTest(const FString& Parameters)
+{
+	TestEqual(TEXT("Value at the weapon"), FWeaponMath::Falloff(2.f, 10.f, 0.f, 100.f), 10.f);
+	TestEqual(TEXT("Linear within the reach"), FWeaponMath::Falloff(2.f, 10.f, 75.f, 100.f), 4.f);
+	TestEqual(TEXT("Value at the reach"), FWeaponMath::Falloff(2.f, 10.f, 100.f, 100.f), 2.f);
+	TestEqual(TEXT("Clamped beyond the reach"), FWeaponMath::Falloff(2.f, 10.f, 500.f, 100.f), 2.f);
+	TestEqual(TEXT("Clamped behind the weapon"), FWeaponMath::Falloff(2.f, 10.f, -50.f, 100.f), 10.f);
+	TestEqual(TEXT("Rising falloff"), FWeaponMath::Falloff(10.f, 2.f, 50.f, 100.f), 6.f);
+	TestEqual(TEXT("Value at the reach with zero reach"), FWeaponMath::Falloff(2.f, 10.f, 0.f, 0.f), 2.f);
+
+	// The batch version has to agree with the scalar one, including the edges and a zero reach.
+	const float Distances[] = { -50.f, 0.f, 12.5f, 50.f, 99.f, 100.f, 500.f };
+	float Values[UE_ARRAY_COUNT(Distances)];
+	for (const float MaxReach : { 100.f, 0.f })
+	{
+		FWeaponMath::FalloffBatch(2.f, 10.f, MaxReach, Distances, Values);
+		for (int32 i = 0; i < UE_ARRAY_COUNT(Distances); ++i)
+		{
+			TestEqual(FString::Printf(TEXT("Batch matches scalar at %.1f with reach %.0f"), Distances[i], MaxReach),
+				Values[i], FWeaponMath::Falloff(2.f, 10.f, Distances[i], MaxReach), KINDA_SMALL_NUMBER);
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWeaponMathImpulseToVelocityTest, "Arbetsprov.Weapons.WeaponMath.ImpulseToVelocity", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWeaponMathImpulseToVelocityTest::RunTest(const FString& Parameters)
+{
+	TestEqual(TEXT("Impulse divided by mass"), FWeaponMath::ImpulseToVelocity(1000.f, 4.f), 250.f);
+	TestEqual(TEXT("Negative impulse"), FWeaponMath::ImpulseToVelocity(-1000.f, 4.f), -250.f);
+	TestEqual(TEXT("Zero mass doesn't move"), FWeaponMath::ImpulseToVelocity(1000.f, 0.f), 0.f);
+	TestEqual(TEXT("Negligible mass doesn't move"), FWeaponMath::ImpulseToVelocity(1000.f, KINDA_SMALL_NUMBER), 0.f);
+	TestEqual(TEXT("Negative mass doesn't move"), FWeaponMath::ImpulseToVelocity(1000.f, -4.f), 0.f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWeaponMathBallisticPositionTest, "Arbetsprov.Weapons.WeaponMath.BallisticPosition", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWeaponMathBallisticPositionTest::RunTest(const FString& Parameters)
+{
+	const FVector Start(100.f, 0.f, 50.f);
+	const FVector Velocity(1000.f, 0.f, 500.f);
+	const FVector Gravity(0.f, 0.f, -980.f);
+
+	TestEqual(TEXT("Starts at the start"), FWeaponMath::BallisticPosition(Start, Velocity, Gravity, 0.f), Start);
+	TestEqual(TEXT("Straight line without gravity"), FWeaponMath::BallisticPosition(Start, Velocity, FVector::ZeroVector, 2.f), Start + Velocity * 2.f);
+	TestEqual(TEXT("Falls from rest"), FWeaponMath::BallisticPosition(FVector::ZeroVector, FVector::ZeroVector, Gravity, 1.f), FVector(0.f, 0.f, -490.f));
+
+	// The apex of the arc is where the vertical velocity is zero.
+	const float ApexTime = 500.f / 980.f;
+	const FVector Apex = FWeaponMath::BallisticPosition(Start, Velocity, Gravity, ApexTime);
+	TestEqual(TEXT("Apex height"), Apex.Z, 50.f + 500.f * 500.f / (2.f * 980.f), KINDA_SMALL_NUMBER * 100.f);
+	TestTrue(TEXT("Lower before the apex"), FWeaponMath::BallisticPosition(Start, Velocity, Gravity, ApexTime * 0.5f).Z < Apex.Z);
+	TestTrue(TEXT("Lower after the apex"), FWeaponMath::BallisticPosition(Start, Velocity, Gravity, ApexTime * 1.5f).Z < Apex.Z);
+
+	return true;
+}
+
+/**
+ * Compares the scalar falloff in a loop against the batch version, on as many distances as a busy tractor beam sees.
+ * Reports both times, it only fails if the results differ since timings vary between machines.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWeaponMathFalloffBenchmark, "Arbetsprov.Weapons.WeaponMath.FalloffBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FWeaponMathFalloffBenchmark::RunTest(const FString& Parameters)
+{
+	static constexpr int32 NUM_DISTANCES = 256;
+	static constexpr int32 NUM_ITERATIONS = 20000;
+	static constexpr float MAX_REACH = 2500.f;
+
+	TArray<float> Distances;
+	Distances.SetNumUninitialized(NUM_DISTANCES);
+	FRandomStream Random(NUM_DISTANCES);
+	for (float& Distance : Distances)
+	{
+		Distance = Random.FRandRange(-100.f, MAX_REACH + 100.f);
+	}
+
+	TArray<float> ScalarValues;
+	TArray<float> BatchValues;
+	ScalarValues.SetNumUninitialized(NUM_DISTANCES);
+	BatchValues.SetNumUninitialized(NUM_DISTANCES);
+
+	// Accumulating the results keeps the loops from being optimized away.
+	float Sink = 0.f;
+
+	const double ScalarStart = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NUM_ITERATIONS; ++Iteration)
+	{
+		for (int32 i = 0; i < NUM_DISTANCES; ++i)
+		{
+			ScalarValues[i] = FWeaponMath::Falloff(500.f, 2000.f, Distances[i], MAX_REACH);
+		}
+		Sink += ScalarValues[Iteration % NUM_DISTANCES];
+	}
+	const double ScalarSeconds = FPlatformTime::Seconds() - ScalarStart;
+
+	const double BatchStart = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NUM_ITERATIONS; ++Iteration)
+	{
+		FWeaponMath::FalloffBatch(500.f, 2000.f, MAX_REACH, Distances, BatchValues);
+		Sink += BatchValues[Iteration % NUM_DISTANCES];
+	}
+	const double BatchSeconds = FPlatformTime::Seconds() - BatchStart;
+
+	const double NumValues = double(NUM_DISTANCES) * NUM_ITERATIONS;
+	AddInfo(FString::Printf(TEXT("Scalar: %.2f ns per value, batch: %.2f ns per value, %.2fx (checksum %f)."),
+		ScalarSeconds * 1.e9 / NumValues, BatchSeconds * 1.e9 / NumValues, ScalarSeconds / FMath::Max(BatchSeconds, 1.e-9), Sink));
+
+	for (int32 i = 0; i < NUM_DISTANCES; ++i)
+	{
+		if (!FMath::IsNearlyEqual(ScalarValues[i], BatchValues[i], 1.e-2f))
+		{
+			AddError(FString::Printf(TEXT("Batch value %f differs from scalar value %f at distance %f."), BatchValues[i], ScalarValues[i], Distances[i]));
+			break;
+		}
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
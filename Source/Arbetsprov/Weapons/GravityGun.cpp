@@ -4,30 +4,76 @@
 #include "GravityGun.h"
 #include "Components/PrimitiveComponent.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "DrawDebugHelpers.h"
 #include "Engine/World.h"
+#include "Field/FieldSystemComponent.h"
+#include "Field/FieldSystemObjects.h"
+#include "HAL/IConsoleManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "Net/LagCompensationSubsystem.h"
 #include "PhysicsEngine/PhysicsHandleComponent.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "Props/GrabbablePropManager.h"
+#include "Telemetry/TelemetrySubsystem.h"
+#include "Weapons/WeaponMath.h"
+#include "WorldCollision.h"
+
+static TAutoConsoleVariable<int32> CVarGravityGunPushBackend(
+	TEXT("arbetsprov.GravityGun.PushBackend"),
+	-1,
+	TEXT("Overrides the push backend of every gravity gun.\n")
+	TEXT("-1: Each gun's own setting, 0: Impulse, 1: Physics field"));
+
+DECLARE_CYCLE_STAT(TEXT("Tractor Beam"), STAT_TractorBeam, STATGROUP_Game);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tractor Beam Bodies"), STAT_TractorBeamBodies, STATGROUP_Game);
 
 AGravityGun::AGravityGun(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 	PrimaryActorTick.bCanEverTick = true;
 
 	PhysicsHandle = CreateDefaultSubobject<UPhysicsHandleComponent>(TEXT("Physics Handle")); 
+
+#if WITH_CHAOS
+	// Only Chaos evaluates fields, PhysX pushes with impulses instead.
+	FieldSystem = CreateDefaultSubobject<UFieldSystemComponent>(TEXT("Field System"));
+	PushFalloffField = CreateDefaultSubobject<URadialFalloff>(TEXT("Push Falloff Field"));
+	PushDirectionField = CreateDefaultSubobject<UUniformVector>(TEXT("Push Direction Field"));
+	PushField = CreateDefaultSubobject<UOperatorField>(TEXT("Push Field"));
+#endif
+}
+
+void AGravityGun::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The handle moves the held object toward its target when it ticks, make sure the target is set first.
+	PhysicsHandle->SetTickGroup(TG_PrePhysics);
+	PhysicsHandle->AddTickPrerequisiteActor(this);
 }
 
 void AGravityGun::Tick(float DeltaTime)
 {
+	UTelemetrySubsystem::Count(this, ETelemetryCounter::ActiveGravityGuns);
+
 	FHitResult Hit;
 	if(FindClosestObjectInReach(Hit) && Hit.GetComponent()->IsSimulatingPhysics())
 	{
 		SetGunState(EGunState::Target);
+		CurrentTarget = Hit.GetComponent();
 	}
 	else
 	{
 		SetGunState(EGunState::NoTarget);
+		CurrentTarget = nullptr;
 	}
 
 	PullGrabbedObject();
+	UpdateThrowArc();
+
+	if (bTractorActive)
+	{
+		ApplyTractorBeam();
+	}
 }
 
 bool AGravityGun::PrimaryAction()
@@ -38,13 +84,18 @@ bool AGravityGun::PrimaryAction()
 		bPushSuccess = PushObject();
 	}
 
+	if (bPushSuccess)
+	{
+		UTelemetrySubsystem::Count(this, ETelemetryCounter::Pushes);
+	}
+
 	if (bPushSuccess && PushSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, PushSound, GetMuzzleLocation());
+		PlayGunSound(PushSound);
 	}
 	else if (NoTargetSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, NoTargetSound, GetMuzzleLocation());
+		PlayGunSound(NoTargetSound);
 	}
 	
 	return bPushSuccess;
@@ -57,9 +108,14 @@ bool AGravityGun::SecondaryAction()
 	{
 		bSuccess = GrabObject();
 
+		if (bSuccess)
+		{
+			UTelemetrySubsystem::Count(this, ETelemetryCounter::Grabs);
+		}
+
 		if (bSuccess && GrabSound)
 		{
-			UGameplayStatics::PlaySoundAtLocation(this, GrabSound, GetMuzzleLocation());
+			PlayGunSound(GrabSound);
 		}
 	}
 	else
@@ -68,18 +124,65 @@ bool AGravityGun::SecondaryAction()
 
 		if (bSuccess && ReleaseSound)
 		{
-			UGameplayStatics::PlaySoundAtLocation(this, ReleaseSound, GetMuzzleLocation());
+			PlayGunSound(ReleaseSound);
 		}
 	}
 
 	if (!bSuccess && NoTargetSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, NoTargetSound, GetMuzzleLocation());
+		PlayGunSound(NoTargetSound);
 	}
 
 	return bSuccess;
 }
 
+bool AGravityGun::StartContinuousAction()
+{
+	bTractorActive = true;
+
+	return true;
+}
+
+void AGravityGun::StopContinuousAction()
+{
+	bTractorActive = false;
+}
+
+void AGravityGun::WarmUp()
+{
+	Super::WarmUp();
+
+	for (USoundBase* Sound : { PushSound, GrabSound, ReleaseSound, NoTargetSound })
+	{
+		if (Sound)
+		{
+			UGameplayStatics::PrimeSound(Sound);
+		}
+	}
+}
+
+void AGravityGun::Holster()
+{
+	ReleaseGrabbedObject();
+	CurrentTarget = nullptr;
+
+	Super::Holster();
+}
+
+void AGravityGun::FillStateSnapshot(FGunStateSnapshot& Snapshot) const
+{
+	Super::FillStateSnapshot(Snapshot);
+
+	Snapshot.TargetComponent = CurrentTarget;
+
+	if (PhysicsHandle && PhysicsHandle->GetGrabbedComponent())
+	{
+		FVector Location, Direction;
+		GetGravityCenterAndDirection(Location, Direction);
+		Snapshot.HeldObjectDistance = FVector::Distance(Location, PhysicsHandle->GetGrabbedComponent()->GetCenterOfMass());
+	}
+}
+
 void AGravityGun::GetGravityCenterAndDirection(FVector& Center, FVector& Direction) const
 {
 	const bool bSuccess = GetPlayerLookLocationAndDirection(Center, Direction);
@@ -96,31 +199,77 @@ void AGravityGun::GetGravityCenterAndDirection(FVector& Center, FVector& Directi
 }
 
 bool AGravityGun::FindClosestObjectInReach(FHitResult& Hit) const
+{
+	// Actions performed from a client's view trace the world as that client saw it.
+	const FGunActionView* View = GetActionView();
+	return FindClosestObjectInReachAtTime(Hit, View ? View->Timestamp : GetWorld()->GetTimeSeconds());
+}
+
+bool AGravityGun::FindClosestObjectInReachAtTime(FHitResult& Hit, float Timestamp) const
 {
 	FVector Location, Direction;
 	GetGravityCenterAndDirection(Location, Direction);
+	const FVector End = Location + Direction * MaxReachDistance;
 
-	return GetWorld()->LineTraceSingleByChannel(
-		Hit,
-		Location,
-		Location + Direction * MaxReachDistance,
-		ECollisionChannel::ECC_Visibility,
-		FCollisionQueryParams(FName(TEXT("")), false, GetOwner())
-	);
+	// Only the server records history, and there is nothing to rewind for the present.
+	ULagCompensationSubsystem* LagCompensation = HasAuthority() && Timestamp < GetWorld()->GetTimeSeconds()
+		? GetWorld()->GetSubsystem<ULagCompensationSubsystem>()
+		: nullptr;
+
+	UTelemetrySubsystem::Count(this, ETelemetryCounter::Traces);
+	const bool bHitSomething = LagCompensation
+		? LagCompensation->LineTraceSingleByChannelAtTime(Hit, Location, End, ECollisionChannel::ECC_Visibility, GetTraceParams(), Timestamp)
+		: GetWorld()->LineTraceSingleByChannel(Hit, Location, End, ECollisionChannel::ECC_Visibility, GetTraceParams());
+
+	// Idle props are instances, targeting one promotes it to a simulating component.
+	if (bHitSomething)
+	{
+		AGrabbablePropManager::PromoteHit(Hit);
+	}
+
+	return bHitSomething;
 }
 
-bool AGravityGun::GrabObject() const
+FVector AGravityGun::GetPresentHitLocation(const FHitResult& Hit) const
+{
+	const FGunActionView* View = GetActionView();
+	ULagCompensationSubsystem* LagCompensation = View ? GetWorld()->GetSubsystem<ULagCompensationSubsystem>() : nullptr;
+	const UPrimitiveComponent* Component = Hit.GetComponent();
+
+	FTransform Past;
+	if (!LagCompensation || !Component || !LagCompensation->GetTransformAtTime(Component, View->Timestamp, Past))
+	{
+		return Hit.Location;
+	}
+
+	// The same point on the body, where the body is now.
+	return Component->GetComponentTransform().TransformPosition(Past.InverseTransformPosition(Hit.Location));
+}
+
+bool AGravityGun::GrabObject()
 {
 	FHitResult Hit;
 	const bool bHitSomething = FindClosestObjectInReach(Hit);
 
-	if (bHitSomething && PhysicsHandle && Hit.GetComponent() && Hit.GetComponent()->IsSimulatingPhysics())
+	return bHitSomething && HoldComponent(Hit.GetComponent());
+}
+
+bool AGravityGun::HoldComponent(UPrimitiveComponent* Component)
+{
+	if (PhysicsHandle && Component && Component->IsSimulatingPhysics())
 	{
+		const FGravityHoldProfile& Profile = GetHoldProfile(Component);
+		PhysicsHandle->SetLinearStiffness(Profile.LinearStiffness);
+		PhysicsHandle->SetLinearDamping(Profile.LinearDamping);
+		PhysicsHandle->SetAngularStiffness(Profile.AngularStiffness);
+		PhysicsHandle->SetAngularDamping(Profile.AngularDamping);
+
 		PhysicsHandle->GrabComponentAtLocation(
-			Hit.GetComponent(),
+			Component,
 			NAME_None,
-			Hit.GetComponent()->GetCenterOfMass()
+			Component->GetCenterOfMass()
 		);
+		AGrabbablePropManager::NotifyHeld(Component, true);
 
 		return true;
 	}
@@ -128,10 +277,51 @@ bool AGravityGun::GrabObject() const
 	return false;
 }
 
+UPrimitiveComponent* AGravityGun::GetHeldComponent() const
+{
+	return PhysicsHandle ? PhysicsHandle->GetGrabbedComponent() : nullptr;
+}
+
+const FGravityHoldProfile& AGravityGun::GetHoldProfile(UPrimitiveComponent* Component) const
+{
+	const float Mass = Component->GetMass();
+	const float Radius = FMath::Max(Component->Bounds.SphereRadius, 1.f);
+
+	// Bodies sharing a setup and roughly the same mass and size, within a quarter octave each, share a profile.
+	// The size is part of the key since one body setup is shared by every scale of a mesh.
+	const int32 MassBucket = FMath::RoundToInt(FMath::Log2(FMath::Max(Mass, KINDA_SMALL_NUMBER)) * 4.f);
+	const int32 RadiusBucket = FMath::RoundToInt(FMath::Log2(Radius) * 4.f);
+	const FHoldProfileKey Key(FObjectKey(Component->GetBodySetup()), MassBucket, RadiusBucket);
+
+	if (const FGravityHoldProfile* Cached = HoldProfileCache.Find(Key))
+	{
+		return *Cached;
+	}
+
+	// Interpolate the frequency on a log scale since masses span orders of magnitude.
+	const float MassAlpha = FMath::Clamp(
+		FMath::Loge(FMath::Max(Mass, HoldTuning.LightMass) / HoldTuning.LightMass) / FMath::Loge(FMath::Max(HoldTuning.HeavyMass / HoldTuning.LightMass, 1.f + KINDA_SMALL_NUMBER)),
+		0.f,
+		1.f
+	);
+	const float LinearFrequency = FMath::Lerp(HoldTuning.LightLinearFrequency, HoldTuning.HeavyLinearFrequency, MassAlpha);
+	const float AngularFrequency = HoldTuning.AngularFrequency * FMath::Min(HoldTuning.ReferenceRadius / Radius, 1.f);
+
+	// Acceleration drive: stiffness = w^2, damping = 2 * zeta * w.
+	FGravityHoldProfile Profile;
+	Profile.LinearStiffness = FMath::Square(LinearFrequency);
+	Profile.LinearDamping = 2.f * HoldTuning.DampingRatio * LinearFrequency;
+	Profile.AngularStiffness = FMath::Square(AngularFrequency);
+	Profile.AngularDamping = 2.f * HoldTuning.DampingRatio * AngularFrequency;
+
+	return HoldProfileCache.Add(Key, Profile);
+}
+
 bool AGravityGun::ReleaseGrabbedObject()
 {
 	if(PhysicsHandle->GetGrabbedComponent())
 	{
+		AGrabbablePropManager::NotifyHeld(PhysicsHandle->GetGrabbedComponent(), false);
 		PhysicsHandle->ReleaseComponent();
 		bGrabbedObjectAtGravityCenter = false;
 		PhysicsHandle->bInterpolateTarget = true;
@@ -142,7 +332,7 @@ bool AGravityGun::ReleaseGrabbedObject()
 	return false;
 }
 
-bool AGravityGun::PushObject() const 
+bool AGravityGun::PushObject()
 {
 	FHitResult Hit;
 	const bool bHitSomething = FindClosestObjectInReach(Hit);
@@ -152,9 +342,14 @@ bool AGravityGun::PushObject() const
 		FVector Location, Direction;
 		GetGravityCenterAndDirection(Location, Direction);
 
+		// The force falls off with the distance the player saw, but is applied where the body is now.
 		const float Distance = FVector::Distance(Location, Hit.Location);
-		const float PushForce = FMath::Lerp(MinPushForce, MaxPushForce, (MaxReachDistance - Distance) / MaxReachDistance);
-		Hit.GetComponent()->AddImpulseAtLocation(Direction * PushForce, Hit.Location);
+		const float PushForce = FWeaponMath::Falloff(MinPushForce, MaxPushForce, Distance, MaxReachDistance);
+		const FVector PushLocation = GetPresentHitLocation(Hit);
+		if (GetPushBackend() != EGravityGunPushBackend::PhysicsField || !PushWithField(Hit.GetComponent(), PushLocation, Direction, PushForce))
+		{
+			Hit.GetComponent()->AddImpulseAtLocation(Direction * PushForce, PushLocation);
+		}
 
 		return true;
 	}
@@ -170,7 +365,7 @@ bool AGravityGun::PushGrabbedObject()
 		GetGravityCenterAndDirection(Location, Direction);
 
 		const float Distance = FVector::Distance(Location, PhysicsHandle->GetGrabbedComponent()->GetCenterOfMass());
-		const float PushForce = FMath::Lerp(MinPushForce, MaxPushForce, (MaxReachDistance - Distance) / MaxReachDistance);
+		const float PushForce = FWeaponMath::Falloff(MinPushForce, MaxPushForce, Distance, MaxReachDistance);
 		PhysicsHandle->GetGrabbedComponent()->AddImpulseAtLocation(Direction * PushForce, PhysicsHandle->GetGrabbedComponent()->GetCenterOfMass());
 		ReleaseGrabbedObject();
 
@@ -180,6 +375,63 @@ bool AGravityGun::PushGrabbedObject()
 	return false;
 }
 
+EGravityGunPushBackend AGravityGun::GetPushBackend() const
+{
+	const int32 Override = CVarGravityGunPushBackend.GetValueOnGameThread();
+	if (Override < 0) return PushBackend;
+
+	return Override == 0 ? EGravityGunPushBackend::Impulse : EGravityGunPushBackend::PhysicsField;
+}
+
+bool AGravityGun::PushWithField(UPrimitiveComponent* HitComponent, const FVector& Location, const FVector& Direction, float PushForce)
+{
+#if WITH_CHAOS
+	// The field is applied as a force over the next physics step, which is the frame delta split into substeps if enabled.
+	const UPhysicsSettings* PhysicsSettings = UPhysicsSettings::Get();
+	float StepSeconds = FMath::Min(GetWorld()->GetDeltaSeconds(), PhysicsSettings->MaxPhysicsDeltaTime);
+	if (PhysicsSettings->bSubstepping)
+	{
+		StepSeconds = FMath::Min(StepSeconds, PhysicsSettings->MaxSubstepDeltaTime);
+	}
+	if (!FieldSystem || StepSeconds <= 0.f) return false;
+
+	// Scale the force so the impulse over one step matches PushForce.
+	PushFalloffField->SetRadialFalloff(PushForce / StepSeconds, 0.f, 1.f, 0.f, PushFieldRadius, Location, EFieldFalloffType::Field_Falloff_Linear);
+	PushDirectionField->SetUniformVector(1.f, Direction);
+	PushField->SetOperatorField(1.f, PushDirectionField, PushFalloffField, EFieldOperationType::Field_Multiply);
+
+	FieldSystem->ApplyPhysicsField(true, EFieldPhysicsType::Field_LinearForce, nullptr, PushField);
+#else
+	// PhysX has no fields. The hit body gets the same push as with the impulse backend, so MinPushForce and MaxPushForce
+	// keep their meaning, and the bodies around it get the field's linear falloff as one batch of impulses.
+	HitComponent->AddImpulseAtLocation(Direction * PushForce, Location);
+
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECollisionChannel::ECC_PhysicsBody);
+	ObjectParams.AddObjectTypesToQuery(ECollisionChannel::ECC_WorldDynamic);
+
+	TArray<FOverlapResult>& Overlaps = GetFrameScratch().Overlaps;
+	UTelemetrySubsystem::Count(this, ETelemetryCounter::Traces);
+	GetWorld()->OverlapMultiByObjectType(Overlaps, Location, FQuat::Identity, ObjectParams, FCollisionShape::MakeSphere(PushFieldRadius), GetTraceParams());
+
+	const UPrimitiveComponent* GrabbedComponent = PhysicsHandle ? PhysicsHandle->GetGrabbedComponent() : nullptr;
+	for (FOverlapResult& Overlap : Overlaps)
+	{
+		AGrabbablePropManager::PromoteOverlap(Overlap);
+
+		UPrimitiveComponent* Component = Overlap.GetComponent();
+		if (!Component || Component == GrabbedComponent || Component == HitComponent) continue;
+
+		const float Distance = FVector::Distance(Location, Component->GetCenterOfMass());
+		PushImpulses.Add(Component, Direction * FWeaponMath::Falloff(0.f, PushForce, Distance, PushFieldRadius));
+	}
+
+	PushImpulses.ApplyImpulses(GetWorld());
+#endif
+
+	return true;
+}
+
 bool AGravityGun::PullGrabbedObject()
 {
 	if (PhysicsHandle && PhysicsHandle->GetGrabbedComponent())
@@ -191,7 +443,7 @@ bool AGravityGun::PullGrabbedObject()
 		if(!bGrabbedObjectAtGravityCenter)
 		{
 			const float Distance = FVector::Distance(Location + Direction * ComponentRadius, PhysicsHandle->GetGrabbedComponent()->GetCenterOfMass());
-			const float PullSpeed = FMath::Lerp(MinPullSpeed, MaxPullSpeed, (MaxReachDistance - Distance) / MaxReachDistance);
+			const float PullSpeed = FWeaponMath::Falloff(MinPullSpeed, MaxPullSpeed, Distance, MaxReachDistance);
 			PhysicsHandle->SetInterpolationSpeed(PullSpeed);
 
 			static constexpr float DISTANCE_TO_STOP_INTERPOLATION = 5.f;
@@ -210,3 +462,199 @@ bool AGravityGun::PullGrabbedObject()
 
 	return false;
 }
+
+int32 AGravityGun::ApplyTractorBeam()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TractorBeam);
+
+	FVector Location, Direction;
+	GetGravityCenterAndDirection(Location, Direction);
+
+	// A capsule from the gravity center to the end of the reach, its axis along the beam. The half height includes
+	// the rounded ends, so the capsule doesn't reach behind the gravity center.
+	const float HalfLength = FMath::Max(MaxReachDistance * 0.5f, TractorRadius);
+	const FCollisionShape Capsule = FCollisionShape::MakeCapsule(TractorRadius, HalfLength);
+	const FQuat Rotation = FRotationMatrix::MakeFromZ(Direction).ToQuat();
+
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECollisionChannel::ECC_PhysicsBody);
+	ObjectParams.AddObjectTypesToQuery(ECollisionChannel::ECC_WorldDynamic);
+
+	TArray<FOverlapResult>& Overlaps = GetFrameScratch().Overlaps;
+	UTelemetrySubsystem::Count(this, ETelemetryCounter::Traces);
+	GetWorld()->OverlapMultiByObjectType(Overlaps, Location + Direction * HalfLength, Rotation, ObjectParams, Capsule, GetTraceParams());
+
+	TractorBodies.Reset();
+	TractorDistances.Reset();
+
+	const UPrimitiveComponent* GrabbedComponent = PhysicsHandle ? PhysicsHandle->GetGrabbedComponent() : nullptr;
+	for (FOverlapResult& Overlap : Overlaps)
+	{
+		// Idle props are instances, the beam promotes them as long as the prop manager has components left.
+		AGrabbablePropManager::PromoteOverlap(Overlap);
+
+		UPrimitiveComponent* Component = Overlap.GetComponent();
+		if (!Component || Component == GrabbedComponent) continue;
+
+		// Bodies only touching the beam with their center behind the gravity center would be pulled into the player.
+		const float Distance = FVector::DotProduct(Component->GetCenterOfMass() - Location, Direction);
+		if (Distance < 0.f) continue;
+
+		TractorBodies.Add(Component);
+		TractorDistances.Add(Distance);
+	}
+
+	TractorAccelerations.SetNumUninitialized(TractorDistances.Num(), false);
+	FWeaponMath::FalloffBatch(MinTractorAcceleration, MaxTractorAcceleration, MaxReachDistance, TractorDistances, TractorAccelerations);
+
+	for (int32 i = 0; i < TractorBodies.Num(); ++i)
+	{
+		UPrimitiveComponent* Component = TractorBodies[i];
+		const FVector ToCenter = Location - Component->GetCenterOfMass();
+		const float DistanceToCenter = ToCenter.Size();
+
+		// Toward the gravity center, and toward the axis so bodies at the edge of the beam converge instead of orbiting.
+		const FVector ToAxis = Direction * FVector::DotProduct(ToCenter, Direction) - ToCenter;
+		const FVector PullDirection = (ToCenter.GetSafeNormal() + ToAxis / TractorRadius).GetClampedToMaxSize(1.f);
+
+		// Within TractorRadius of the center the pull fades out and damping takes over, so bodies settle at the center
+		// instead of flying past it.
+		const float Arrival = FMath::Clamp(DistanceToCenter / TractorRadius, 0.f, 1.f);
+		const FVector Damping = Component->GetPhysicsLinearVelocity() * -TractorDamping * (1.f - Arrival);
+
+		TractorForces.Add(Component, PullDirection * TractorAccelerations[i] * Arrival + Damping);
+	}
+
+	const int32 NumBodies = TractorForces.Num();
+	INC_DWORD_STAT_BY(STAT_TractorBeamBodies, NumBodies);
+
+	TractorForces.Apply(GetWorld(), true);
+
+	return NumBodies;
+}
+
+void AGravityGun::UpdateThrowArc()
+{
+	UPrimitiveComponent* Component = PhysicsHandle ? PhysicsHandle->GetGrabbedComponent() : nullptr;
+	if (!bThrowPreview || !Component)
+	{
+		ThrowArc.Reset();
+		ThrowArcComponent = nullptr;
+		return;
+	}
+
+	if (ThrowArcComponent != Component)
+	{
+		ThrowArcTraceParams = GetTraceParams();
+		ThrowArcTraceParams.AddIgnoredComponent(Component);
+		ThrowArcComponent = Component;
+		ThrowArc.Reset();
+		ThrowArcTraceCursor = 0;
+	}
+
+	FVector Location, Direction;
+	GetGravityCenterAndDirection(Location, Direction);
+
+	// Same impulse as PushGrabbedObject, turned into the velocity it would add.
+	const FVector Start = Component->GetCenterOfMass();
+	const float Distance = FVector::Distance(Location, Start);
+	const float PushForce = FWeaponMath::Falloff(MinPushForce, MaxPushForce, Distance, MaxReachDistance);
+	const FVector Velocity = Component->GetPhysicsLinearVelocity() + Direction * FWeaponMath::ImpulseToVelocity(PushForce, Component->GetMass());
+	const FVector Gravity(0.f, 0.f, Component->IsGravityEnabled() ? GetWorld()->GetGravityZ() : 0.f);
+
+	ThrowArc.SetNum(ThrowArcSegments);
+
+	// The path itself is cheap to evaluate, only the traces are budgeted.
+	FVector SegmentStart = Start;
+	for (int32 i = 0; i < ThrowArc.Num(); ++i)
+	{
+		const float Time = (i + 1) * ThrowArcTimeStep;
+		FThrowArcSegment& Segment = ThrowArc[i];
+		Segment.Start = SegmentStart;
+		Segment.End = FWeaponMath::BallisticPosition(Start, Velocity, Gravity, Time);
+		SegmentStart = Segment.End;
+	}
+
+	const float ToleranceSquared = FMath::Square(ThrowArcTolerance);
+	auto IsStale = [ToleranceSquared](const FThrowArcSegment& Segment)
+	{
+		return !Segment.bTraced
+			|| FVector::DistSquared(Segment.Start, Segment.TracedStart) > ToleranceSquared
+			|| FVector::DistSquared(Segment.End, Segment.TracedEnd) > ToleranceSquared;
+	};
+
+	// Nothing past a segment known to hit with its current ends needs tracing.
+	int32 NumNeeded = ThrowArc.Num();
+	for (int32 i = 0; i < ThrowArc.Num(); ++i)
+	{
+		if (ThrowArc[i].bBlocked && !IsStale(ThrowArc[i]))
+		{
+			NumNeeded = i + 1;
+			break;
+		}
+	}
+
+	// Continue where the last frame ran out of budget, so every stale segment is traced within a few frames
+	// even if the whole path moves every frame. Until then a segment keeps its last result.
+	int32 TracesLeft = ThrowArcTraceBudget;
+	for (int32 Visited = 0; Visited < NumNeeded && TracesLeft > 0; ++Visited)
+	{
+		const int32 Index = (ThrowArcTraceCursor + Visited) % NumNeeded;
+		FThrowArcSegment& Segment = ThrowArc[Index];
+		if (!IsStale(Segment)) continue;
+
+		--TracesLeft;
+		ThrowArcTraceCursor = Index + 1;
+		UTelemetrySubsystem::Count(this, ETelemetryCounter::Traces);
+
+		FHitResult Hit;
+		Segment.bBlocked = GetWorld()->LineTraceSingleByChannel(Hit, Segment.Start, Segment.End, ECollisionChannel::ECC_Visibility, ThrowArcTraceParams);
+		Segment.HitLocation = Hit.Location;
+		Segment.TracedStart = Segment.Start;
+		Segment.TracedEnd = Segment.End;
+		Segment.bTraced = true;
+	}
+
+	if (bDrawThrowPreview)
+	{
+		DrawThrowArc();
+	}
+}
+
+bool AGravityGun::GetThrowArc(TArray<FVector>& OutPoints) const
+{
+	OutPoints.Reset();
+	if (ThrowArc.Num() == 0) return false;
+
+	OutPoints.Add(ThrowArc[0].Start);
+	for (const FThrowArcSegment& Segment : ThrowArc)
+	{
+		// Segments not traced since they moved use their last result until the budget reaches them.
+		if (Segment.bTraced && Segment.bBlocked)
+		{
+			OutPoints.Add(Segment.HitLocation);
+			return true;
+		}
+
+		OutPoints.Add(Segment.End);
+	}
+
+	return false;
+}
+
+void AGravityGun::DrawThrowArc() const
+{
+#if ENABLE_DRAW_DEBUG
+	for (const FThrowArcSegment& Segment : ThrowArc)
+	{
+		if (Segment.bTraced && Segment.bBlocked)
+		{
+			DrawDebugLine(GetWorld(), Segment.Start, Segment.HitLocation, FColor::Cyan);
+			DrawDebugPoint(GetWorld(), Segment.HitLocation, 10.f, FColor::Cyan);
+			return;
+		}
+
+		DrawDebugLine(GetWorld(), Segment.Start, Segment.End, FColor::Cyan);
+	}
+#endif
+}
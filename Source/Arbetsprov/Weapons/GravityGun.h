@@ -3,9 +3,72 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
 #include "Weapons/Gun.h"
+#include "Weapons/PhysicsForceBatch.h"
 #include "GravityGun.generated.h"
 
+/** How pushes are applied to physics bodies. */
+UENUM()
+enum class EGravityGunPushBackend : uint8
+{
+	/** One impulse on the targeted body. */
+	Impulse,
+	/** Every body around the target, with a physics field applied by the solver with Chaos, or one batch of impulses with PhysX. */
+	PhysicsField
+};
+
+/** Stiffness and damping of the physics handle while holding a body. */
+USTRUCT(BlueprintType)
+struct FGravityHoldProfile
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Physics Handle")
+	float LinearStiffness = 750.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Physics Handle")
+	float LinearDamping = 200.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Physics Handle")
+	float AngularStiffness = 1500.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Physics Handle")
+	float AngularDamping = 500.f;
+};
+
+/**
+ * How hold profiles are derived from the grabbed body.
+ * The handle drives acceleration, so a profile is a natural frequency and damping ratio:
+ * heavy and large bodies get lower frequencies so they don't oscillate, light ones are critically damped so they don't overshoot.
+ */
+USTRUCT(BlueprintType)
+struct FGravityHoldTuning
+{
+	GENERATED_BODY()
+
+	/** Bodies at or below this mass use LightLinearFrequency. */
+	UPROPERTY(EditDefaultsOnly, Category = "Physics Handle", meta = (ClampMin = "0.001"))
+	float LightMass = 10.f;
+	/** Bodies at or above this mass use HeavyLinearFrequency. */
+	UPROPERTY(EditDefaultsOnly, Category = "Physics Handle", meta = (ClampMin = "0.001"))
+	float HeavyMass = 500.f;
+
+	/** Natural frequency of the linear drive in rad/s for light bodies. */
+	UPROPERTY(EditDefaultsOnly, Category = "Physics Handle", meta = (ClampMin = "0"))
+	float LightLinearFrequency = 30.f;
+	/** Natural frequency of the linear drive in rad/s for heavy bodies. */
+	UPROPERTY(EditDefaultsOnly, Category = "Physics Handle", meta = (ClampMin = "0"))
+	float HeavyLinearFrequency = 12.f;
+
+	/** Natural frequency of the angular drive in rad/s for a body of ReferenceRadius, scaled inversely with the radius. */
+	UPROPERTY(EditDefaultsOnly, Category = "Physics Handle", meta = (ClampMin = "0"))
+	float AngularFrequency = 20.f;
+	UPROPERTY(EditDefaultsOnly, Category = "Physics Handle", meta = (ClampMin = "1"))
+	float ReferenceRadius = 50.f;
+
+	/** 1 is critically damped, settling as fast as possible without overshooting. */
+	UPROPERTY(EditDefaultsOnly, Category = "Physics Handle", meta = (ClampMin = "0"))
+	float DampingRatio = 1.f;
+};
+
 /**
  * Representa a Gravity Gun, inheriting from the Gun class.
  */
@@ -18,7 +81,7 @@ public:
 	/** Using FObjectInitializer form of construction because no-argument constructor leads to multiple default super constructors. */
 	AGravityGun(const FObjectInitializer& ObjectInitializer);
 
-	/** Tick function */
+	/** Tick function, in TG_PrePhysics after the owner so the handle target uses this frame's view. */
 	virtual void Tick(float DeltaTime) override;
 
 	/** Beam attack that pushes objects. */
@@ -27,6 +90,50 @@ public:
 	/** Pulls objects to the gravity gun. */
 	virtual bool SecondaryAction() override;
 
+	/** Starts the tractor beam, pulling every body along the beam while held. */
+	virtual bool StartContinuousAction() override;
+
+	/** Stops the tractor beam. */
+	virtual void StopContinuousAction() override;
+
+	/** Primes the sounds of the gun so the first actions don't wait for them to load. */
+	virtual void WarmUp() override;
+
+	/** Releases any grabbed object before putting the gun away. */
+	virtual void Holster() override;
+
+	/**
+	 * Holds a simulating component with the physics handle, tuned for its mass and size.
+	 * @param Component - The component to hold.
+	 * @return Whether or not the component is now held.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Action")
+	bool HoldComponent(UPrimitiveComponent* Component);
+
+	/** 
+	 * Release any grabbed object
+	 * @return Whether or not a grabbed object was released.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Action")
+	bool ReleaseGrabbedObject();
+
+	/** Returns the component currently held, or nullptr if nothing is held. */
+	UPrimitiveComponent* GetHeldComponent() const;
+
+	/**
+	 * Gets the predicted path of the held object if it was pushed now, up to where it first hits something.
+	 * @param OutPoints - Upon return will contain the points of the path, empty if nothing is held or the preview is disabled.
+	 * @return Whether or not the path ends in a hit.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Weapon")
+	bool GetThrowArc(TArray<FVector>& OutPoints) const;
+
+protected:
+	virtual void BeginPlay() override;
+
+	/** Adds the target and the distance to the held object. */
+	virtual void FillStateSnapshot(FGunStateSnapshot& Snapshot) const override;
+
 private:
 	/** 
 	 * The location of the center of the gravity effect and its direction.
@@ -39,32 +146,50 @@ private:
 
 	/**
 	 * Linetrace to find the closest visible object in line-of-sight.
+	 * While an action is performed from a client's view, the trace is rewound to the time of that view.
 	 * @param Hit - Upon return will contain the result of the linetrace.
 	 * @return Whether something was hit by the linetrace or not.
 	 */
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
 	bool FindClosestObjectInReach(FHitResult& Hit) const;
 
+	/**
+	 * Linetrace to find the closest visible object in line-of-sight as the world was at a point in time.
+	 * Used by the server to evaluate what a client aimed at, falls back to the present time without lag compensation.
+	 * @param Hit - Upon return will contain the result of the linetrace, with locations where bodies were at the time.
+	 * @param Timestamp - Server world time the client saw when aiming.
+	 * @return Whether something was hit by the linetrace or not.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Weapon")
+	bool FindClosestObjectInReachAtTime(FHitResult& Hit, float Timestamp) const;
+
+	/**
+	 * Maps the location of a hit found while performing an action from a view to where the hit body is now.
+	 * @param Hit - A hit found by FindClosestObjectInReach.
+	 * @return The location on the body in the present, the hit location if nothing was rewound.
+	 */
+	FVector GetPresentHitLocation(const FHitResult& Hit) const;
+
 	/**
 	 * Grab the closest object.
 	 * @return Whether or not an object was grabbed.
 	 */
 	UFUNCTION(BlueprintCallable, Category = "Action")
-	bool GrabObject() const;
+	bool GrabObject();
 
-	/** 
-	 * Release any grabbed object
-	 * @return Whether or not a grabbed object was released.
+	/**
+	 * Gets the hold profile for a body, computed once per body setup, mass and size and then cached.
+	 * @param Component - The body to hold.
+	 * @return The profile to apply to the physics handle.
 	 */
-	UFUNCTION(BlueprintCallable, Category = "Action")
-	bool ReleaseGrabbedObject();
+	const FGravityHoldProfile& GetHoldProfile(UPrimitiveComponent* Component) const;
 
 	/**
 	 * Push the closest object.
 	 * @return Whether or not an object was pushed.
 	 */
 	UFUNCTION(BlueprintCallable, Category = "Action")
-	bool PushObject() const;
+	bool PushObject();
 
 	/**
 	 * Push the grabbed object.
@@ -73,6 +198,20 @@ private:
 	UFUNCTION(BlueprintCallable, Category = "Action")
 	bool PushGrabbedObject();
 
+	/**
+	 * Push every body around a location with a physics field, or without Chaos with the full impulse on the hit body
+	 * and a batch of impulses on its neighbours, falling off with distance from the location.
+	 * @param HitComponent - The body that was hit.
+	 * @param Location - The center of the field, where the body was hit.
+	 * @param Direction - The direction to push in.
+	 * @param PushForce - The impulse a body at the center receives.
+	 * @return Whether or not the field could be applied.
+	 */
+	bool PushWithField(UPrimitiveComponent* HitComponent, const FVector& Location, const FVector& Direction, float PushForce);
+
+	/** Returns the push backend to use, PushBackend unless arbetsprov.GravityGun.PushBackend overrides it. */
+	EGravityGunPushBackend GetPushBackend() const;
+
 	/**
 	 * Pull any grabbed object towards the gravity center of the gravity gun, offsetting for object radius.
 	 * @return Whether or not a grabbed object was pulled.
@@ -80,10 +219,37 @@ private:
 	UFUNCTION(BlueprintCallable, Category = "Action")
 	bool PullGrabbedObject();
 
+	/**
+	 * Pulls every simulating body in a capsule along the beam towards the gravity center and the beam's axis,
+	 * slowing them down as they arrive. One overlap finds the bodies, their forces are applied together in one batch.
+	 * @return The amount of bodies pulled.
+	 */
+	int32 ApplyTractorBeam();
+
+	/**
+	 * Updates the predicted path of the held object. The path is recomputed every frame but only segments
+	 * that moved are traced again, at most ThrowArcTraceBudget per frame, continuing from where the last frame stopped.
+	 */
+	void UpdateThrowArc();
+
+	/** Draws the predicted path of the held object. */
+	void DrawThrowArc() const;
+
 	/** Physics Handle Component handles most of the grabbing/pulling functionality of the gravity gun. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Physics Handle", meta = (AllowPrivateAccess = "True"))
 	class UPhysicsHandleComponent* PhysicsHandle = nullptr;
 
+	/** Field System Component applies pushes in bulk when the push backend is PhysicsField and the physics engine is Chaos. Only created with Chaos. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Physics Field", meta = (AllowPrivateAccess = "True"))
+	class UFieldSystemComponent* FieldSystem = nullptr;
+
+	UPROPERTY()
+	class URadialFalloff* PushFalloffField = nullptr;
+	UPROPERTY()
+	class UUniformVector* PushDirectionField = nullptr;
+	UPROPERTY()
+	class UOperatorField* PushField = nullptr;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Setup")
 	float MaxReachDistance = 2500.f;
 	UPROPERTY(EditDefaultsOnly, Category = "Setup")
@@ -98,6 +264,24 @@ private:
 	float PlayerMuzzleOffset = 100.f;
 	UPROPERTY(EditDefaultsOnly, Category = "Setup")
 	float MuzzleOffset = 50.f;
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+	EGravityGunPushBackend PushBackend = EGravityGunPushBackend::Impulse;
+	/** Radius around the target affected by a push when using the PhysicsField backend. */
+	UPROPERTY(EditDefaultsOnly, Category = "Setup", meta = (EditCondition = "PushBackend == EGravityGunPushBackend::PhysicsField"))
+	float PushFieldRadius = 300.f;
+
+	/** Radius of the capsule around the beam affected by the tractor beam. */
+	UPROPERTY(EditDefaultsOnly, Category = "Tractor", meta = (ClampMin = "1"))
+	float TractorRadius = 150.f;
+	/** Acceleration towards the gravity center in cm/s^2 of a body at MaxReachDistance, regardless of its mass. */
+	UPROPERTY(EditDefaultsOnly, Category = "Tractor", meta = (ClampMin = "0"))
+	float MinTractorAcceleration = 500.f;
+	/** Acceleration towards the gravity center in cm/s^2 of a body near the gravity center, regardless of its mass. Fades out within TractorRadius of it. */
+	UPROPERTY(EditDefaultsOnly, Category = "Tractor", meta = (ClampMin = "0"))
+	float MaxTractorAcceleration = 2000.f;
+	/** How quickly bodies at the gravity center lose their velocity, per second. Fades in over TractorRadius from the center. */
+	UPROPERTY(EditDefaultsOnly, Category = "Tractor", meta = (ClampMin = "0"))
+	float TractorDamping = 10.f;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Audio")
 	USoundBase* PushSound;
@@ -108,5 +292,71 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "Audio")
 	USoundBase* NoTargetSound;
 
+	UPROPERTY(EditDefaultsOnly, Category = "Physics Handle")
+	FGravityHoldTuning HoldTuning;
+
+	/** Whether or not to predict where a held object would go if pushed. */
+	UPROPERTY(EditDefaultsOnly, Category = "Throw Preview")
+	bool bThrowPreview = false;
+	/** Whether or not to draw the predicted path, the path can be read with GetThrowArc regardless. */
+	UPROPERTY(EditDefaultsOnly, Category = "Throw Preview", meta = (EditCondition = "bThrowPreview"))
+	bool bDrawThrowPreview = true;
+	UPROPERTY(EditDefaultsOnly, Category = "Throw Preview", meta = (EditCondition = "bThrowPreview", ClampMin = "1"))
+	int32 ThrowArcSegments = 24;
+	/** Seconds of flight covered by each segment. */
+	UPROPERTY(EditDefaultsOnly, Category = "Throw Preview", meta = (EditCondition = "bThrowPreview", ClampMin = "0.001"))
+	float ThrowArcTimeStep = 0.05f;
+	/** Maximum amount of segments traced per frame. */
+	UPROPERTY(EditDefaultsOnly, Category = "Throw Preview", meta = (EditCondition = "bThrowPreview", ClampMin = "1"))
+	int32 ThrowArcTraceBudget = 4;
+	/** Segments whose ends moved less than this since they were traced keep their result. */
+	UPROPERTY(EditDefaultsOnly, Category = "Throw Preview", meta = (EditCondition = "bThrowPreview", ClampMin = "0"))
+	float ThrowArcTolerance = 2.f;
+
+	/** A segment of the predicted path and the result of its last trace. */
+	struct FThrowArcSegment
+	{
+		FVector Start = FVector::ZeroVector;
+		FVector End = FVector::ZeroVector;
+		FVector TracedStart = FVector::ZeroVector;
+		FVector TracedEnd = FVector::ZeroVector;
+		FVector HitLocation = FVector::ZeroVector;
+		bool bTraced = false;
+		bool bBlocked = false;
+	};
+
+	TArray<FThrowArcSegment> ThrowArc;
+
+	/** Segment the next frame's traces start from. */
+	int32 ThrowArcTraceCursor = 0;
+
+	/** Trace params of the throw arc, the gun's params with the held object ignored. */
+	FCollisionQueryParams ThrowArcTraceParams;
+
+	/** The held object ThrowArcTraceParams were built for. */
+	TWeakObjectPtr<UPrimitiveComponent> ThrowArcComponent;
+
+	/** Body setup, mass bucket and bounds radius bucket of a held body. */
+	using FHoldProfileKey = TTuple<FObjectKey, int32, int32>;
+
+	/** Hold profiles by body setup, mass bucket and radius bucket. */
+	mutable TMap<FHoldProfileKey, FGravityHoldProfile> HoldProfileCache;
+
+	/** The physics simulating component found by the last targeting trace. */
+	TWeakObjectPtr<UPrimitiveComponent> CurrentTarget;
+
+	/** Forces of the tractor beam, kept between frames so it doesn't allocate. */
+	FPhysicsForceBatch TractorForces;
+
+	/** Impulses of a push with the PhysicsField backend without Chaos. */
+	FPhysicsForceBatch PushImpulses;
+
+	/** Bodies in the tractor beam this frame and their distances and accelerations, kept between frames so they don't allocate. */
+	TArray<UPrimitiveComponent*> TractorBodies;
+	TArray<float> TractorDistances;
+	TArray<float> TractorAccelerations;
+
+	bool bTractorActive = false;
+
 	bool bGrabbedObjectAtGravityCenter = false;
 };
@@ -2,14 +2,114 @@
 
 
 #include "Gun.h"
+#include "Camera/CameraComponent.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
 #include "GameFramework/Pawn.h"
+#include "GameFramework/PawnMovementComponent.h"
 #include "GameFramework/PlayerController.h"
+#include "Net/LagCompensationSubsystem.h"
+#include "TimerManager.h"
+
+static const FName MuzzleSocketName(TEXT("Muzzle"));
 
 AGun::AGun(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 	GunMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Weapon Mesh"));
 	SetRootComponent(GunMesh);
+
+	// Dropped guns replicate quantized movement, only to clients nearby and only while moving.
+	bReplicates = true;
+	SetReplicatingMovement(true);
+	bNetUseOwnerRelevancy = true;
+	NetCullDistanceSquared = FMath::Square(5000.f);
+	FRepMovement& Movement = GetReplicatedMovement_Mutable();
+	Movement.LocationQuantizationLevel = EVectorQuantization::RoundOneDecimal;
+	Movement.VelocityQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	Movement.RotationQuantizationLevel = ERotatorQuantization::ByteComponents;
+
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	SnapshotTickFunction.TickGroup = TG_PostPhysics;
+	SnapshotTickFunction.bCanEverTick = true;
+	SnapshotTickFunction.bStartWithTickEnabled = true;
+
+	RebuildTraceParams();
+}
+
+void AGun::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Guns placed in the level lie around like dropped ones until picked up.
+	if (!GetOwner())
+	{
+		NetUpdateFrequency = DroppedNetUpdateFrequency;
+	}
+}
+
+float AGun::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	// A held gun is as important as whoever holds it, e.g. the viewer's own gun gets the viewer's priority.
+	if (AActor* GunOwner = GetOwner())
+	{
+		return GunOwner->GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth);
+	}
+
+	return Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth);
+}
+
+void AGun::SetOwner(AActor* NewOwner)
+{
+	SetOwnerTickPrerequisites(GetOwner(), false);
+
+	Super::SetOwner(NewOwner);
+
+	SetOwnerTickPrerequisites(NewOwner, true);
+	OwnerCamera = NewOwner ? NewOwner->FindComponentByClass<UCameraComponent>() : nullptr;
+	RebuildTraceParams();
+}
+
+void AGun::SetOwnerTickPrerequisites(AActor* InOwner, bool bAdd)
+{
+	APawn* Pawn = Cast<APawn>(InOwner);
+	if (!Pawn) return;
+
+	// The pawn's tick depends on its controller, which applies the look input, and the movement
+	// component moves the camera. Targeting after both means the gun always uses this frame's view.
+	UPawnMovementComponent* Movement = Pawn->GetMovementComponent();
+	if (bAdd)
+	{
+		AddTickPrerequisiteActor(Pawn);
+		if (Movement)
+		{
+			AddTickPrerequisiteComponent(Movement);
+		}
+	}
+	else
+	{
+		RemoveTickPrerequisiteActor(Pawn);
+		if (Movement)
+		{
+			RemoveTickPrerequisiteComponent(Movement);
+		}
+	}
+}
+
+void AGun::RegisterActorTickFunctions(bool bRegister)
+{
+	Super::RegisterActorTickFunctions(bRegister);
+
+	if (bRegister)
+	{
+		SnapshotTickFunction.Target = this;
+		SnapshotTickFunction.SetTickFunctionEnable(!bDormant);
+		SnapshotTickFunction.RegisterTickFunction(GetLevel());
+	}
+	else if (SnapshotTickFunction.IsTickFunctionRegistered())
+	{
+		SnapshotTickFunction.UnRegisterTickFunction();
+	}
 }
 
 bool AGun::PrimaryAction()
@@ -22,31 +122,118 @@ bool AGun::SecondaryAction()
 	return false;
 }
 
+bool AGun::PrimaryActionFromView(const FGunActionView& View)
+{
+	ActionView = View;
+	const bool bSuccess = PrimaryAction();
+	ActionView.Reset();
+
+	return bSuccess;
+}
+
+bool AGun::SecondaryActionFromView(const FGunActionView& View)
+{
+	ActionView = View;
+	const bool bSuccess = SecondaryAction();
+	ActionView.Reset();
+
+	return bSuccess;
+}
+
+void AGun::WarmUp()
+{
+}
+
+bool AGun::StartContinuousAction()
+{
+	return false;
+}
+
+void AGun::StopContinuousAction()
+{
+}
+
 AGun* AGun::PickUp(AActor* NewOwner)
 {
 	GunMesh->SetSimulatePhysics(false);
 	SetOwner(NewOwner);
 	SetGunState(EGunState::NoTarget);
 
+	// Held guns follow their owner's relevancy and attachment, no need to watch the body.
+	GetWorldTimerManager().ClearTimer(DormancyTimerHandle);
+	SetNetDormancy(DORM_Awake);
+	NetUpdateFrequency = GetDefault<AGun>(GetClass())->NetUpdateFrequency;
+
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterBody(GunMesh);
+	}
+
 	return this;
 }
 
 void AGun::Drop()
 {
+	StopContinuousAction();
+	SetDormant(false);
 	DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
 	SetOwner(nullptr);
 	GunMesh->SetSimulatePhysics(true);
 	SetGunState(EGunState::Dropped);
+
+	if (HasAuthority())
+	{
+		NetUpdateFrequency = DroppedNetUpdateFrequency;
+		SetNetDormancy(DORM_Awake);
+		GetWorldTimerManager().SetTimer(DormancyTimerHandle, this, &AGun::UpdateNetDormancy, DormancyCheckInterval, true);
+
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterBody(GunMesh);
+		}
+	}
+}
+
+void AGun::Holster()
+{
+	StopContinuousAction();
+	SetDormant(true);
+	SetGunState(EGunState::Holstered);
+
+	// Snapshots aren't published while holstered, leave one behind that says so.
+	PublishStateSnapshot();
+}
+
+void AGun::Draw()
+{
+	SetDormant(false);
+	SetGunState(EGunState::NoTarget);
 }
 
 bool AGun::GetPlayerLookLocationAndDirection(FVector& WorldLocation, FVector& WorldDirection) const
 {
+	if (ActionView.IsSet())
+	{
+		WorldLocation = ActionView->Location;
+		WorldDirection = ActionView->Direction;
+		return true;
+	}
+
 	const APawn* Pawn = Cast<APawn>(GetOwner());
 	if (!Pawn) return false;
 
 	const APlayerController* Controller = Cast<APlayerController>(Pawn->GetController());
 	if (!Controller) return false;
 
+	// The camera manager's view is only updated at the end of the frame, use the camera directly to see this frame's view.
+	const UCameraComponent* Camera = OwnerCamera.Get();
+	if (Camera && Camera->bUsePawnControlRotation)
+	{
+		WorldLocation = Camera->GetComponentLocation();
+		WorldDirection = Controller->GetControlRotation().Vector();
+		return true;
+	}
+
 	int32 ViewportSizeX, ViewportSizeY;
 	Controller->GetViewportSize(ViewportSizeX, ViewportSizeY);
 	return Controller->DeprojectScreenPositionToWorld(ViewportSizeX * 0.5f, ViewportSizeY * 0.5f, WorldLocation, WorldDirection);
@@ -56,7 +243,7 @@ FVector AGun::GetMuzzleLocation() const
 {
 	if(GunMesh)
 	{
-		return GunMesh->GetSocketLocation(TEXT("Muzzle"));
+		return GunMesh->GetSocketLocation(MuzzleSocketName);
 	}
 
 	return FVector::ZeroVector;
@@ -66,7 +253,7 @@ FRotator AGun::GetMuzzleRotation() const
 {
 	if (GunMesh)
 	{
-		return GunMesh->GetSocketRotation(TEXT("Muzzle"));
+		return GunMesh->GetSocketRotation(MuzzleSocketName);
 	}
 
 	return FRotator::ZeroRotator;
@@ -77,6 +264,74 @@ void AGun::SetGunState(EGunState State)
 	GunState = State;
 }
 
+bool AGun::PlayGunSound(USoundBase* Sound) const
+{
+	if (!Sound || !GetWorld()) return false;
+
+	UWeaponAudioSubsystem* Audio = GetWorld()->GetSubsystem<UWeaponAudioSubsystem>();
+	if (!Audio) return false;
+
+	return Audio->PlaySoundAtLocation(Sound, GetMuzzleLocation(), this, SoundLimits);
+}
+
+FWeaponFrameScratch& AGun::GetFrameScratch() const
+{
+	FrameScratch.BeginFrame();
+
+	return FrameScratch;
+}
+
+void AGun::RebuildTraceParams()
+{
+	TraceParams = FCollisionQueryParams(SCENE_QUERY_STAT(GunTrace), false, GetOwner());
+}
+
+void AGun::UpdateNetDormancy()
+{
+	if (!GunMesh) return;
+
+	if (GunMesh->RigidBodyIsAwake())
+	{
+		if (NetDormancy != DORM_Awake)
+		{
+			SetNetDormancy(DORM_Awake);
+		}
+	}
+	else if (NetDormancy != DORM_DormantAll)
+	{
+		// The resting transform is still sent before the channel goes dormant.
+		ForceNetUpdate();
+		SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+void AGun::SetDormant(bool bNewDormant)
+{
+	if (bDormant == bNewDormant) return;
+	bDormant = bNewDormant;
+
+	SetActorTickEnabled(!bDormant);
+	SetActorHiddenInGame(bDormant);
+
+	if (GunMesh)
+	{
+		if (bDormant)
+		{
+			ActiveCollisionEnabled = GunMesh->GetCollisionEnabled();
+			GunMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		}
+		else
+		{
+			GunMesh->SetCollisionEnabled(ActiveCollisionEnabled);
+		}
+
+		GunMesh->SetComponentTickEnabled(!bDormant);
+		GunMesh->bNoSkeletonUpdate = bDormant;
+	}
+
+	SnapshotTickFunction.SetTickFunctionEnable(!bDormant);
+}
+
 EGunState AGun::GetGunState() const
 {
 	return GunState;
@@ -87,3 +342,41 @@ FLinearColor AGun::GetCrosshairColor() const
 	return CrosshairColorsByState.FindRef(GunState);
 }
 
+FGunStateSnapshot AGun::GetStateSnapshot() const
+{
+	return StateBuffer.Read();
+}
+
+void AGun::PublishStateSnapshot()
+{
+	FGunStateSnapshot Snapshot;
+	FillStateSnapshot(Snapshot);
+	Snapshot.FrameNumber = GFrameCounter;
+
+	StateBuffer.Publish(Snapshot);
+}
+
+void AGun::FillStateSnapshot(FGunStateSnapshot& Snapshot) const
+{
+	Snapshot.State = GunState;
+	Snapshot.CrosshairColor = GetCrosshairColor();
+
+	if (GunMesh)
+	{
+		Snapshot.MuzzleTransform = GunMesh->GetSocketTransform(MuzzleSocketName);
+	}
+}
+
+void FGunSnapshotTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && !Target->IsPendingKillOrUnreachable())
+	{
+		Target->PublishStateSnapshot();
+	}
+}
+
+FString FGunSnapshotTickFunction::DiagnosticMessage()
+{
+	return Target ? Target->GetFullName() + TEXT("[PublishStateSnapshot]") : TEXT("GunSnapshotTick");
+}
+
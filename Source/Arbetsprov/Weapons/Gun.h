@@ -3,7 +3,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
 #include "GameFramework/Actor.h"
+#include "Weapons/GunStateSnapshot.h"
+#include "Weapons/WeaponAudioSubsystem.h"
+#include "Weapons/WeaponFrameScratch.h"
 #include "Gun.generated.h"
 
 UENUM()
@@ -17,6 +21,35 @@ enum class EGunState : uint8
 	Holstered
 };
 
+/** A view an action is performed from and the server world time it was seen at, e.g. a client's when it pressed the button. */
+struct FGunActionView
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Direction = FVector::ForwardVector;
+	float Timestamp = 0.f;
+};
+
+/** Publishes the state snapshot of a gun once per frame, after physics. */
+USTRUCT()
+struct FGunSnapshotTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	class AGun* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FGunSnapshotTickFunction> : public TStructOpsTypeTraitsBase2<FGunSnapshotTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
 /** Class representing a gun. Gun-like weapons inherit from this class. */
 UCLASS()
 class ARBETSPROV_API AGun : public AActor
@@ -27,6 +60,16 @@ public:
 	/** Using FObjectInitializer form of construction because no-argument constructor leads to multiple default constructors for inheriting classes */
 	AGun(const FObjectInitializer& ObjectInitializer);
 
+	virtual void BeginPlay() override;
+
+	/** Held guns use the priority of their owner, dropped ones the distance based priority of any actor. */
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
+	/** Rebuilds the cached trace params since they ignore the owner. */
+	virtual void SetOwner(AActor* NewOwner) override;
+
+	virtual void RegisterActorTickFunctions(bool bRegister) override;
+
 	/**
 	 * Method representing the primary action of the gun e.g. shooting a bullet.
 	 * @return A boolean value representing whether the action could be carried out.
@@ -41,6 +84,32 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	virtual bool SecondaryAction();
 
+	/**
+	 * Performs the primary action from a view at a point in time instead of the owner's current view.
+	 * On the server, traces of the action see tracked bodies where they were at that time.
+	 * @param View - The view and time to perform the action from.
+	 * @return A boolean value representing whether the action could be carried out.
+	 */
+	bool PrimaryActionFromView(const FGunActionView& View);
+
+	/**
+	 * Performs the secondary action from a view at a point in time instead of the owner's current view.
+	 * @param View - The view and time to perform the action from.
+	 * @return A boolean value representing whether the action could be carried out.
+	 */
+	bool SecondaryActionFromView(const FGunActionView& View);
+
+	/**
+	 * Method representing an action that lasts while its button is held e.g. a continuous beam.
+	 * @return A boolean value representing whether the action could be started.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	virtual bool StartContinuousAction();
+
+	/** Stops the action started by StartContinuousAction, also called when the gun is holstered or dropped. */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	virtual void StopContinuousAction();
+
 	// TODO: Create interface for objects that can be picked up / interacted with.
 
 	/**
@@ -56,6 +125,17 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	void Drop();
 
+	/** Puts the gun away, making it fully dormant: no tick, no collision, hidden and without skeleton updates. */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	virtual void Holster();
+
+	/** Takes the gun out of the holster, active again from the same frame. */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	virtual void Draw();
+
+	/** Loads or creates what the first use of the gun would otherwise do lazily, e.g. its sounds. Called when the local player's HUD begins play. */
+	virtual void WarmUp();
+
 	/**
 	 * Gets the current state of the gun.
 	 * @return The enum representing the state.
@@ -70,9 +150,31 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Crosshair")
 	FLinearColor GetCrosshairColor() const;
 
+	/**
+	 * Gets the state of the gun as published at the end of the last snapshot tick. Safe to call from any thread.
+	 * @return A copy of the latest snapshot.
+	 */
+	FGunStateSnapshot GetStateSnapshot() const;
+
+	/** Builds and publishes a snapshot of the current state. Game thread only. */
+	void PublishStateSnapshot();
+
+	/** Returns the tick function that publishes the state snapshot. */
+	FORCEINLINE FTickFunction& GetSnapshotTickFunction() { return SnapshotTickFunction; }
+
 protected:
+	/**
+	 * Fills a snapshot with the current state, subclasses add what they know about.
+	 * @param Snapshot - The snapshot to fill.
+	 */
+	virtual void FillStateSnapshot(FGunStateSnapshot& Snapshot) const;
+
+	/** Returns the view the current action is performed from, nullptr outside of PrimaryActionFromView and SecondaryActionFromView. */
+	FORCEINLINE const FGunActionView* GetActionView() const { return ActionView.IsSet() ? &ActionView.GetValue() : nullptr; }
+
 	/**
 	 * Attempts to find the location and direction that the player is looking based on which pawn owns the weapon.
+	 * While an action is performed from a view, that view is used.
 	 * @param WorldLocation - Location in the world that the center of the player's viewport is.
 	 * @param WorldDirection - Direction in the world that the center of the player's viewport is looking.
 	 * @return Whether or not it was successful in finding a location and direction.
@@ -101,7 +203,40 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "State")
 	void SetGunState(EGunState State);
 
+	/**
+	 * Plays a sound at the muzzle through the weapon audio subsystem, which pools and throttles it.
+	 * @param Sound - The sound to play.
+	 * @return Whether or not the sound was played.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Audio")
+	bool PlayGunSound(USoundBase* Sound) const;
+
+	/** Returns the collision query params for the gun's traces, prebuilt so traces don't construct them every frame. */
+	FORCEINLINE const FCollisionQueryParams& GetTraceParams() const { return TraceParams; }
+
+	/** Returns the scratch storage for temporary query results, cleared once per frame. */
+	FWeaponFrameScratch& GetFrameScratch() const;
+
 private:
+	/** Builds the trace params, ignoring the current owner. */
+	void RebuildTraceParams();
+
+	/**
+	 * Makes the gun tick after, or stops it from waiting for, the pawn owning it.
+	 * @param InOwner - The owner.
+	 * @param bAdd - Whether to add or remove the prerequisites.
+	 */
+	void SetOwnerTickPrerequisites(AActor* InOwner, bool bAdd);
+
+	/** Makes a dropped gun net dormant while its body sleeps and wakes it when it moves. Server only. */
+	void UpdateNetDormancy();
+
+	/**
+	 * Turns tick, rendering and collision of the gun off or back on.
+	 * @param bDormant - Whether or not the gun should be dormant.
+	 */
+	void SetDormant(bool bDormant);
+
 	UPROPERTY(VisibleDefaultsOnly, Category = "Mesh")
 	USkeletalMeshComponent* GunMesh = nullptr;
 
@@ -110,4 +245,37 @@ private:
 
 	UPROPERTY(EditDefaultsOnly, Category = "HUD")
 	TMap<EGunState, FLinearColor> CrosshairColorsByState;
+
+	/** Limits applied to every sound played by the gun. */
+	UPROPERTY(EditDefaultsOnly, Category = "Audio")
+	FWeaponSoundLimits SoundLimits;
+
+	/** How often a dropped gun is considered for replication while its body is awake. Held guns use the class's NetUpdateFrequency. */
+	UPROPERTY(EditDefaultsOnly, Category = "Replication", meta = (ClampMin = "1"))
+	float DroppedNetUpdateFrequency = 10.f;
+
+	/** How often a dropped gun checks whether its body went to sleep or woke up. */
+	UPROPERTY(EditDefaultsOnly, Category = "Replication", meta = (ClampMin = "0.05"))
+	float DormancyCheckInterval = 0.5f;
+
+	FTimerHandle DormancyTimerHandle;
+
+	/** Camera of the owner, its transform is up to date during this frame's tick unlike the camera manager's view. */
+	TWeakObjectPtr<class UCameraComponent> OwnerCamera;
+
+	FCollisionQueryParams TraceParams;
+
+	/** Set while an action is performed from a view. */
+	TOptional<FGunActionView> ActionView;
+
+	/** Collision of the mesh before the gun went dormant, restored when it's drawn. */
+	TEnumAsByte<ECollisionEnabled::Type> ActiveCollisionEnabled = ECollisionEnabled::QueryAndPhysics;
+
+	bool bDormant = false;
+
+	mutable FWeaponFrameScratch FrameScratch;
+
+	FGunSnapshotTickFunction SnapshotTickFunction;
+
+	FGunStateBuffer StateBuffer;
 };
@@ -0,0 +1,87 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMisc.h"
+#include "Templates/Atomic.h"
+
+enum class EGunState : uint8;
+class UPrimitiveComponent;
+
+/** The state of a gun at the end of a frame, for consumers outside of the gun's tick. */
+struct FGunStateSnapshot
+{
+	/** Zero initialized, which is EGunState::NoTarget. */
+	EGunState State{};
+
+	FLinearColor CrosshairColor = FLinearColor::White;
+
+	/** The component the gun is aimed at. Only resolve it on the game thread, other threads may only compare it. */
+	TWeakObjectPtr<UPrimitiveComponent> TargetComponent;
+
+	/** Distance from the gravity center to the held object, or a negative value if nothing is held. */
+	float HeldObjectDistance = -1.f;
+
+	FTransform MuzzleTransform = FTransform::Identity;
+
+	/** GFrameCounter when the snapshot was published. */
+	uint64 FrameNumber = 0;
+};
+
+/**
+ * Double buffered snapshot written by the game thread and readable from any thread without locks.
+ * The writer fills the slot readers aren't pointed at and then publishes it. Every slot has a sequence
+ * number that is odd while written, a reader retries if the slot it copied was written meanwhile.
+ */
+class FGunStateBuffer
+{
+public:
+	/**
+	 * Publishes a new snapshot. Game thread only.
+	 * @param Snapshot - The snapshot to publish.
+	 */
+	void Publish(const FGunStateSnapshot& Snapshot)
+	{
+		const int32 Slot = 1 - PublishedSlot.Load(EMemoryOrder::Relaxed);
+
+		Sequences[Slot].IncrementExchange();
+		FPlatformMisc::MemoryBarrier();
+		Slots[Slot] = Snapshot;
+		// The copy has to be visible before the sequence turns even again.
+		FPlatformMisc::MemoryBarrier();
+		Sequences[Slot].IncrementExchange();
+
+		PublishedSlot.Store(Slot);
+	}
+
+	/**
+	 * Reads the latest published snapshot. Safe on any thread.
+	 * @return A copy of the latest snapshot.
+	 */
+	FGunStateSnapshot Read() const
+	{
+		for (;;)
+		{
+			const int32 Slot = PublishedSlot.Load();
+			const uint32 SequenceBefore = Sequences[Slot].Load();
+			if (SequenceBefore & 1)
+			{
+				continue;
+			}
+
+			FGunStateSnapshot Snapshot = Slots[Slot];
+			// The copy has to be finished before the sequence is checked again, or a torn copy could pass.
+			FPlatformMisc::MemoryBarrier();
+			if (Sequences[Slot].Load() == SequenceBefore)
+			{
+				return Snapshot;
+			}
+		}
+	}
+
+private:
+	FGunStateSnapshot Slots[2];
+	TAtomic<uint32> Sequences[2] = { {0}, {0} };
+	TAtomic<int32> PublishedSlot{ 0 };
+};
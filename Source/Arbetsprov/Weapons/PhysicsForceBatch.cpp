@@ -0,0 +1,74 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+
+#include "PhysicsForceBatch.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "Physics/PhysicsInterfaceCore.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "PhysicsPublic.h"
+
+DECLARE_CYCLE_STAT(TEXT("Apply Force Batch"), STAT_ApplyForceBatch, STATGROUP_Game);
+
+void FPhysicsForceBatch::Reset()
+{
+	Bodies.Reset();
+	Forces.Reset();
+	Queued.Reset();
+}
+
+bool FPhysicsForceBatch::Add(UPrimitiveComponent* Component, const FVector& Force)
+{
+	if (!Component || !Component->IsSimulatingPhysics()) return false;
+
+	FBodyInstance* BodyInstance = Component->GetBodyInstance();
+	if (!BodyInstance || !BodyInstance->IsValidBodyInstance()) return false;
+
+	bool bAlreadyQueued = false;
+	Queued.Add(Component, &bAlreadyQueued);
+	if (bAlreadyQueued) return false;
+
+	Bodies.Add(BodyInstance);
+	Forces.Add(Force);
+
+	return true;
+}
+
+void FPhysicsForceBatch::Apply(UWorld* World, bool bAccelChange)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ApplyForceBatch);
+
+	FPhysScene* Scene = World ? World->GetPhysicsScene() : nullptr;
+	if (Scene && Bodies.Num() > 0)
+	{
+		FPhysicsCommand::ExecuteWrite(Scene, [this, Scene, bAccelChange]()
+		{
+			for (int32 i = 0; i < Bodies.Num(); ++i)
+			{
+				// Through the scene like FBodyInstance::AddForce, so forces are spread over substeps when substepping.
+				Scene->AddForce_AssumesLocked(Bodies[i], Forces[i], true, bAccelChange);
+			}
+		});
+	}
+
+	Reset();
+}
+
+void FPhysicsForceBatch::ApplyImpulses(UWorld* World)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ApplyForceBatch);
+
+	FPhysScene* Scene = World ? World->GetPhysicsScene() : nullptr;
+	if (Scene && Bodies.Num() > 0)
+	{
+		FPhysicsCommand::ExecuteWrite(Scene, [this]()
+		{
+			for (int32 i = 0; i < Bodies.Num(); ++i)
+			{
+				FPhysicsInterface::AddImpulse_AssumesLocked(Bodies[i]->ActorHandle, Forces[i]);
+			}
+		});
+	}
+
+	Reset();
+}
@@ -0,0 +1,51 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPrimitiveComponent;
+class UWorld;
+struct FBodyInstance;
+
+/**
+ * Collects forces for many bodies and applies them under one physics scene write lock,
+ * instead of locking the scene once per body. Keeps its memory between frames.
+ */
+class FPhysicsForceBatch
+{
+public:
+	/** Removes every queued force, keeping the memory. */
+	void Reset();
+
+	/**
+	 * Queues a force for a simulating component. A component is only queued once per batch.
+	 * @param Component - The component to apply the force to.
+	 * @param Force - The force, or the acceleration if the batch is applied with bAccelChange.
+	 * @return Whether or not the force was queued.
+	 */
+	bool Add(UPrimitiveComponent* Component, const FVector& Force);
+
+	/**
+	 * Applies every queued force and resets the batch.
+	 * @param World - The world whose physics scene the bodies are in.
+	 * @param bAccelChange - Whether the forces are accelerations, ignoring the mass of the bodies.
+	 */
+	void Apply(UWorld* World, bool bAccelChange);
+
+	/**
+	 * Applies every queued force as an impulse at the center of mass and resets the batch.
+	 * @param World - The world whose physics scene the bodies are in.
+	 */
+	void ApplyImpulses(UWorld* World);
+
+	/** Returns the amount of queued forces. */
+	FORCEINLINE int32 Num() const { return Bodies.Num(); }
+
+private:
+	TArray<FBodyInstance*> Bodies;
+	TArray<FVector> Forces;
+
+	/** Components already queued in this batch. */
+	TSet<const UPrimitiveComponent*> Queued;
+};
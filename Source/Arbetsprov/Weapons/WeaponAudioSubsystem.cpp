@@ -0,0 +1,139 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+
+#include "WeaponAudioSubsystem.h"
+#include "Components/AudioComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "Sound/SoundBase.h"
+
+bool UWeaponAudioSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return !IsRunningDedicatedServer();
+}
+
+void UWeaponAudioSubsystem::Deinitialize()
+{
+	for (UAudioComponent* Component : Pool)
+	{
+		if (Component)
+		{
+			Component->Stop();
+			Component->DestroyComponent();
+		}
+	}
+
+	Pool.Empty();
+	HistoryBySound.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWeaponAudioSubsystem::PlaySoundAtLocation(USoundBase* Sound, const FVector& Location, const UObject* Instigator, const FWeaponSoundLimits& Limits)
+{
+	UWorld* World = GetWorld();
+	if (!Sound || !World || World->GetNetMode() == NM_DedicatedServer) return false;
+
+	const float Now = World->GetTimeSeconds();
+	FSoundHistory& History = HistoryBySound.FindOrAdd(FObjectKey(Sound));
+
+	// Merge with the last play if it happened close by a moment ago, regardless of who played it.
+	if (Now - History.LastPlayTime < Limits.MergeWindow && FVector::DistSquared(Location, History.LastPlayLocation) < FMath::Square(Limits.MergeRadius))
+	{
+		return false;
+	}
+
+	// Forget instigators whose cooldown is over or that no longer exist, so the map only holds recent instigators.
+	for (auto It = History.CooldownEndByInstigator.CreateIterator(); It; ++It)
+	{
+		if (Now >= It->Value || It->Key.IsStale())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Throttle the same instigator spamming the same sound.
+	const TWeakObjectPtr<const UObject> InstigatorKey(Instigator);
+	if (History.CooldownEndByInstigator.Contains(InstigatorKey))
+	{
+		return false;
+	}
+
+	// Forget voices that have finished or been handed to another sound.
+	History.Voices.RemoveAll([Sound](const TWeakObjectPtr<UAudioComponent>& Voice)
+	{
+		return !Voice.IsValid() || !Voice->IsPlaying() || Voice->Sound != Sound;
+	});
+
+	UAudioComponent* Component = nullptr;
+	if (History.Voices.Num() >= FMath::Max(Limits.MaxConcurrent, 1))
+	{
+		// Steal the oldest voice of this sound.
+		Component = History.Voices[0].Get();
+		History.Voices.RemoveAt(0, 1, false);
+		Component->Stop();
+	}
+	else
+	{
+		Component = AcquireComponent();
+	}
+
+	if (!Component) return false;
+
+	Component->SetSound(Sound);
+	Component->SetWorldLocation(Location);
+	Component->Play();
+
+	History.Voices.Add(Component);
+	History.LastPlayTime = Now;
+	History.LastPlayLocation = Location;
+	if (Limits.Cooldown > 0.f)
+	{
+		History.CooldownEndByInstigator.Add(InstigatorKey, Now + Limits.Cooldown);
+	}
+
+	return true;
+}
+
+void UWeaponAudioSubsystem::PrewarmPool(int32 Count)
+{
+	Count = FMath::Min(Count, MAX_POOL_SIZE);
+	while (Pool.Num() < Count && CreatePooledComponent())
+	{
+	}
+}
+
+UAudioComponent* UWeaponAudioSubsystem::AcquireComponent()
+{
+	for (UAudioComponent* Component : Pool)
+	{
+		if (Component && !Component->IsPlaying())
+		{
+			return Component;
+		}
+	}
+
+	if (Pool.Num() < MAX_POOL_SIZE)
+	{
+		return CreatePooledComponent();
+	}
+
+	return nullptr;
+}
+
+UAudioComponent* UWeaponAudioSubsystem::CreatePooledComponent()
+{
+	UWorld* World = GetWorld();
+	if (!World || !World->GetWorldSettings()) return nullptr;
+
+	UAudioComponent* Component = NewObject<UAudioComponent>(World->GetWorldSettings());
+	Component->bAutoActivate = false;
+	Component->bAutoDestroy = false;
+	Component->bAllowSpatialization = true;
+	Component->bIsUISound = false;
+	Component->RegisterComponentWithWorld(World);
+
+	Pool.Add(Component);
+
+	return Component;
+}
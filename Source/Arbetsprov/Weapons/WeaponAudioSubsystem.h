@@ -0,0 +1,92 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "WeaponAudioSubsystem.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+
+/** Limits applied to a single sound when played through the weapon audio subsystem. */
+USTRUCT(BlueprintType)
+struct FWeaponSoundLimits
+{
+	GENERATED_BODY()
+
+	/** Maximum number of voices of the same sound playing at once. The oldest voice is stolen when exceeded. */
+	UPROPERTY(EditDefaultsOnly, Category = "Audio", meta = (ClampMin = "1"))
+	int32 MaxConcurrent = 4;
+
+	/** Minimum time in seconds between two plays of the same sound from the same instigator. */
+	UPROPERTY(EditDefaultsOnly, Category = "Audio", meta = (ClampMin = "0"))
+	float Cooldown = 0.1f;
+
+	/** Events of the same sound within this many seconds of the last play are merged into it. */
+	UPROPERTY(EditDefaultsOnly, Category = "Audio", meta = (ClampMin = "0"))
+	float MergeWindow = 0.05f;
+
+	/** Events are only merged if they are within this distance of the last play. */
+	UPROPERTY(EditDefaultsOnly, Category = "Audio", meta = (ClampMin = "0"))
+	float MergeRadius = 200.f;
+};
+
+/**
+ * Plays weapon sounds from a pool of reusable audio components, throttling spammed events.
+ * Does nothing on dedicated servers.
+ */
+UCLASS()
+class ARBETSPROV_API UWeaponAudioSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Plays a sound at a location unless it is throttled by its limits.
+	 * @param Sound - The sound to play.
+	 * @param Location - Location in world space to play the sound at.
+	 * @param Instigator - The object responsible for the sound, used for the cooldown.
+	 * @param Limits - The limits to apply to the sound.
+	 * @return Whether or not the sound was played.
+	 */
+	bool PlaySoundAtLocation(USoundBase* Sound, const FVector& Location, const UObject* Instigator, const FWeaponSoundLimits& Limits);
+
+	/**
+	 * Creates pooled audio components up front so the first plays don't allocate.
+	 * @param Count - The amount of components the pool should hold at least.
+	 */
+	void PrewarmPool(int32 Count);
+
+private:
+	/** Bookkeeping for every sound played through the subsystem. */
+	struct FSoundHistory
+	{
+		float LastPlayTime = -BIG_NUMBER;
+		FVector LastPlayLocation = FVector::ZeroVector;
+		/** When each instigator may play the sound again. Only instigators still cooling down are kept. */
+		TMap<TWeakObjectPtr<const UObject>, float> CooldownEndByInstigator;
+		TArray<TWeakObjectPtr<UAudioComponent>, TInlineAllocator<4>> Voices;
+	};
+
+	/**
+	 * Finds an audio component that isn't playing, creating one if the pool isn't full.
+	 * @return A free audio component or nullptr if the pool is exhausted.
+	 */
+	UAudioComponent* AcquireComponent();
+
+	/** Creates and registers a new pooled audio component. */
+	UAudioComponent* CreatePooledComponent();
+
+	UPROPERTY(Transient)
+	TArray<UAudioComponent*> Pool;
+
+	TMap<FObjectKey, FSoundHistory> HistoryBySound;
+
+	/** Upper limit of pooled audio components. */
+	static constexpr int32 MAX_POOL_SIZE = 32;
+};
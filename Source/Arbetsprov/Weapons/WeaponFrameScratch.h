@@ -0,0 +1,29 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+
+/**
+ * Scratch storage for the temporary results of overlaps done by weapons.
+ * Cleared once per frame while keeping its capacity, so queries don't allocate once warmed up.
+ */
+struct FWeaponFrameScratch
+{
+	/** Results of overlaps, valid until the next frame. */
+	TArray<FOverlapResult> Overlaps;
+
+	/** Clears the results if a new frame has started since the last call. */
+	void BeginFrame()
+	{
+		if (FrameCounter != GFrameCounter)
+		{
+			Overlaps.Reset();
+			FrameCounter = GFrameCounter;
+		}
+	}
+
+private:
+	uint64 FrameCounter = 0;
+};
@@ -0,0 +1,91 @@
+// Copyright 2019 Sanya Larsson All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Pure math shared by weapons, free of any world or component state.
+ * Scalar functions are constexpr so tuning values can be checked at compile time.
+ */
+struct FWeaponMath
+{
+	/**
+	 * How close a distance is to the weapon, 1 at the weapon and 0 at or beyond the reach.
+	 * @param Distance - Distance from the weapon.
+	 * @param MaxReach - Distance at which the weapon stops having an effect.
+	 * @return The alpha in the range [0, 1], 0 if MaxReach isn't positive.
+	 */
+	static constexpr float ReachAlpha(float Distance, float MaxReach)
+	{
+		return MaxReach <= 0.f ? 0.f
+			: Distance <= 0.f ? 1.f
+			: Distance >= MaxReach ? 0.f
+			: (MaxReach - Distance) / MaxReach;
+	}
+
+	/**
+	 * Linear falloff from a value at the weapon to a value at the reach, clamped so it never goes past either.
+	 * Used for push forces, pull speeds and tractor accelerations.
+	 * @param AtReach - The value at or beyond MaxReach.
+	 * @param AtWeapon - The value at the weapon.
+	 * @param Distance - Distance from the weapon.
+	 * @param MaxReach - Distance at which the value reaches AtReach.
+	 * @return The value at the distance.
+	 */
+	static constexpr float Falloff(float AtReach, float AtWeapon, float Distance, float MaxReach)
+	{
+		return AtReach + (AtWeapon - AtReach) * ReachAlpha(Distance, MaxReach);
+	}
+
+	/**
+	 * Falloff for many distances at once.
+	 * @param AtReach - The value at or beyond MaxReach.
+	 * @param AtWeapon - The value at the weapon.
+	 * @param MaxReach - Distance at which the value reaches AtReach.
+	 * @param Distances - Distances from the weapon.
+	 * @param OutValues - Upon return will contain the value at each distance, must be as long as Distances.
+	 */
+	static void FalloffBatch(float AtReach, float AtWeapon, float MaxReach, TArrayView<const float> Distances, TArrayView<float> OutValues)
+	{
+		check(OutValues.Num() >= Distances.Num());
+
+		// Straight loop without branches on the data beyond the clamp so the compiler can vectorize it.
+		const float InvMaxReach = MaxReach > 0.f ? 1.f / MaxReach : 0.f;
+		const float Range = AtWeapon - AtReach;
+		for (int32 i = 0; i < Distances.Num(); ++i)
+		{
+			const float Alpha = FMath::Clamp((MaxReach - Distances[i]) * InvMaxReach, 0.f, 1.f);
+			OutValues[i] = AtReach + Range * Alpha;
+		}
+	}
+
+	/**
+	 * Velocity change of a body from an impulse.
+	 * @param Impulse - The impulse in kg*cm/s.
+	 * @param Mass - The mass of the body in kg.
+	 * @return The velocity change in cm/s, zero for bodies without mass.
+	 */
+	static constexpr float ImpulseToVelocity(float Impulse, float Mass)
+	{
+		return Mass > KINDA_SMALL_NUMBER ? Impulse / Mass : 0.f;
+	}
+
+	/**
+	 * Position of a projectile under constant gravity.
+	 * @param Start - The position at time zero.
+	 * @param Velocity - The velocity at time zero.
+	 * @param Gravity - The constant acceleration.
+	 * @param Time - Seconds since time zero.
+	 * @return The position at the time.
+	 */
+	static FORCEINLINE FVector BallisticPosition(const FVector& Start, const FVector& Velocity, const FVector& Gravity, float Time)
+	{
+		return Start + Velocity * Time + 0.5f * Gravity * Time * Time;
+	}
+};
+
+static_assert(FWeaponMath::ReachAlpha(0.f, 100.f) == 1.f, "Full effect at the weapon.");
+static_assert(FWeaponMath::ReachAlpha(150.f, 100.f) == 0.f, "No effect beyond the reach.");
+static_assert(FWeaponMath::Falloff(0.f, 10.f, 200.f, 100.f) == 0.f, "Falloff never goes below the value at the reach.");
+static_assert(FWeaponMath::Falloff(0.f, 10.f, 50.f, 100.f) == 5.f, "Falloff is linear within the reach.");